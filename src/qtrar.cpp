@@ -1,5 +1,6 @@
 #include <QDebug>
 #include <QHash>
+#include <QThreadPool>
 
 #include "unrar/rar.hpp"
 // Avoid conflict name with Qt::HANDLE
@@ -8,6 +9,25 @@
 #include "qtrar.h"
 #include "qtrarfileinfo.h"
 
+static QThreadPool *s_threadPool = 0;
+
+static void CALLBACK verifyFileProc(wchar_t *fileName, int result, LPARAM userData)
+{
+    QStringList *damagedFiles = reinterpret_cast<QStringList *>(userData);
+    if (result != ERAR_SUCCESS && damagedFiles) {
+        *damagedFiles << QString::fromWCharArray(fileName);
+    }
+}
+
+#ifdef RAR_SMP
+static bool runInThreadPool(PTHREAD_PROC proc, void *data, void *context)
+{
+    // Never queue behind busy threads, unrar runs the task itself then.
+    QThreadPool *pool = static_cast<QThreadPool *>(context);
+    return pool->tryStart([proc, data]() { proc(data); });
+}
+#endif
+
 class QtRARPrivate
 {
     friend class QtRAR;
@@ -231,6 +251,45 @@ int QtRAR::error() const
     return m_p->m_error;
 }
 
+bool QtRAR::repairVolumes()
+{
+    if (isOpen()) {
+        qWarning() << "QtRAR::repairVolumes: Archive is open now! Close it first.";
+        return false;
+    }
+
+    wchar_t arcNameW[MAX_ARC_NAME_SIZE];
+    int arcNameLen = m_p->m_arcName
+            .left(MAX_ARC_NAME_SIZE - 1)
+            .toWCharArray(arcNameW);
+    arcNameW[arcNameLen] = '\0';
+
+    m_p->m_error = RARRepairVolumesW(arcNameW);
+    return m_p->m_error == ERAR_SUCCESS;
+}
+
+bool QtRAR::verify(const QString &password, QStringList *damagedFiles)
+{
+    if (isOpen()) {
+        qWarning() << "QtRAR::verify: Archive is open now! Close it first.";
+        return false;
+    }
+
+    wchar_t arcNameW[MAX_ARC_NAME_SIZE];
+    int arcNameLen = m_p->m_arcName
+            .left(MAX_ARC_NAME_SIZE - 1)
+            .toWCharArray(arcNameW);
+    arcNameW[arcNameLen] = '\0';
+
+    std::wstring passwordW = password.toStdWString();
+    m_p->m_error = RARVerifyVolumesW(
+                arcNameW,
+                password.isEmpty() ? 0 : const_cast<wchar_t *>(passwordW.data()),
+                verifyFileProc,
+                reinterpret_cast<LPARAM>(damagedFiles));
+    return m_p->m_error == ERAR_SUCCESS;
+}
+
 QString QtRAR::archiveName() const
 {
     return m_p->m_arcName;
@@ -361,3 +420,58 @@ Qt::HANDLE QtRAR::unrarArcHandle()
 {
     return m_p->m_hArc;
 }
+
+void QtRAR::setMaxThreadCount(int count)
+{
+#ifdef RAR_SMP
+    SetThreadPoolSize(qMax(count, 0));
+#else
+    Q_UNUSED(count);
+#endif
+}
+
+int QtRAR::maxThreadCount()
+{
+#ifdef RAR_SMP
+    return GetThreadPoolSize();
+#else
+    return 1;
+#endif
+}
+
+bool QtRAR::setThreadPool(QThreadPool *pool)
+{
+#ifdef RAR_SMP
+    if (!SetThreadPoolExecutor(pool ? runInThreadPool : 0, pool)) {
+        qWarning() << "QtRAR::setThreadPool: Thread pool is in use now! Close archives first.";
+        return false;
+    }
+#endif
+    s_threadPool = pool;
+    return true;
+}
+
+QThreadPool *QtRAR::threadPool()
+{
+    return s_threadPool;
+}
+
+void QtRAR::setMemoryPoolLimit(qint64 bytes)
+{
+    SetMemPoolLimit(static_cast<size_t>(qMax(bytes, Q_INT64_C(0))));
+}
+
+qint64 QtRAR::memoryPoolLimit()
+{
+    return static_cast<qint64>(GetMemPoolLimit());
+}
+
+void QtRAR::setHugePagesEnabled(bool enabled)
+{
+    SetMemPoolHugePages(enabled);
+}
+
+bool QtRAR::hugePagesEnabled()
+{
+    return GetMemPoolHugePages();
+}
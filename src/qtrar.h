@@ -6,6 +6,7 @@
 
 #include "qtrar_global.h"
 
+class QThreadPool;
 class QtRARFile;
 struct QtRARFileInfo;
 class QtRARPrivate;
@@ -35,6 +36,17 @@ public:
     OpenMode mode() const;
     int error() const;
 
+    // Restore missing or damaged volumes of multivolume archive
+    // from recovery volumes (*.rev). Archive must be closed.
+    bool repairVolumes();
+
+    // Test all files. Files of non-solid multivolume archive are tested
+    // in parallel, each worker starts from its own range of volumes.
+    // Names of damaged files are appended to damagedFiles.
+    // Archive must be closed.
+    bool verify(const QString &password = QString(),
+                QStringList *damagedFiles = 0);
+
     QString archiveName() const;
     void setArchiveName(const QString &arcName);
     QString comment() const;
@@ -54,6 +66,24 @@ public:
     Qt::HANDLE unrarArcHandle();
     // TODO: auto close？
 
+    // Worker threads are shared by all archives. Change these settings
+    // only when no archive is being extracted. Archives opened later
+    // decode every file with up to maxThreadCount threads, but not more
+    // than the number of CPU cores.
+    static void setMaxThreadCount(int count);
+    static int maxThreadCount();
+    // Fails while any archive is being extracted or tested.
+    static bool setThreadPool(QThreadPool *pool);
+    static QThreadPool *threadPool();
+
+    // Dictionaries, unpack buffers and PPMd models of closed archives are
+    // cached for following archives up to this total size in bytes.
+    // 0 disables cache.
+    static void setMemoryPoolLimit(qint64 bytes);
+    static qint64 memoryPoolLimit();
+    static void setHugePagesEnabled(bool enabled);
+    static bool hugePagesEnabled();
+
 private:
     QtRAR(const QtRAR &that);
     QtRAR &operator=(const QtRAR &that);
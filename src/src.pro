@@ -2,6 +2,7 @@ QT       -= gui
 
 TARGET = QtRAR
 TEMPLATE = lib
+CONFIG += c++14
 
 DEFINES += QTRAR_LIBRARY _FILE_OFFSET_BITS=64 _LARGEFILE_SOURCE RAR_SMP RARDLL
 CONFIG(staticlib): DEFINES += QTRAR_STATIC
@@ -2,16 +2,6 @@
 
 #include "rar.hpp"
 
-#ifdef USE_SSE
-#include "blake2s_sse.cpp"
-#endif
-
-static void blake2s_init_param( blake2s_state *S, uint32 node_offset, uint32 node_depth);
-static void blake2s_update( blake2s_state *S, const byte *in, size_t inlen );
-static void blake2s_final( blake2s_state *S, byte *digest );
-
-#include "blake2sp.cpp"
-
 static const uint32 blake2s_IV[8] =
 {
   0x6A09E667UL, 0xBB67AE85UL, 0x3C6EF372UL, 0xA54FF53AUL,
@@ -32,6 +22,16 @@ static const byte blake2s_sigma[10][16] =
   { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13 , 0 } ,
 };
 
+#ifdef USE_SSE
+#include "blake2s_sse.cpp"
+#endif
+
+static void blake2s_init_param( blake2s_state *S, uint32 node_offset, uint32 node_depth);
+static void blake2s_update( blake2s_state *S, const byte *in, size_t inlen );
+static void blake2s_final( blake2s_state *S, byte *digest );
+
+#include "blake2sp.cpp"
+
 static inline void blake2s_set_lastnode( blake2s_state *S )
 {
   S->f[1] = ~0U;
@@ -55,6 +55,22 @@ void Blake2ThreadData::Update()
   }
 }
 
+#ifdef USE_SSE
+#define BLAKE_AVX_TARGET "avx2"
+#define BLAKE_AVX_NAME(name) name##_avx2
+#include "blake2sp_avx.cpp"
+#undef BLAKE_AVX_TARGET
+#undef BLAKE_AVX_NAME
+
+#define BLAKE_AVX512
+#define BLAKE_AVX_TARGET "avx2,avx512f,avx512vl"
+#define BLAKE_AVX_NAME(name) name##_avx512
+#include "blake2sp_avx.cpp"
+#undef BLAKE_AVX512
+#undef BLAKE_AVX_TARGET
+#undef BLAKE_AVX_NAME
+#endif
+
 #ifdef RAR_SMP
 THREAD_PROC(Blake2Thread)
 {
@@ -64,23 +80,9 @@ THREAD_PROC(Blake2Thread)
 #endif
 
 
-void blake2sp_update( blake2sp_state *S, const byte *in, size_t inlen )
+// Process 8 lanes separately, possibly in different threads.
+static void blake2sp_update_lanes( blake2sp_state *S, const byte *in, size_t inlen )
 {
-  size_t left = S->buflen;
-  size_t fill = sizeof( S->buf ) - left;
-
-  if( left && inlen >= fill )
-  {
-    memcpy( S->buf + left, in, fill );
-
-    for( size_t i = 0; i < PARALLELISM_DEGREE; ++i )
-      blake2s_update( &S->S[i], S->buf + i * BLAKE2S_BLOCKBYTES, BLAKE2S_BLOCKBYTES );
-
-    in += fill;
-    inlen -= fill;
-    left = 0;
-  }
-
   Blake2ThreadData btd_array[PARALLELISM_DEGREE];
 
 #ifdef RAR_SMP
@@ -117,6 +119,40 @@ void blake2sp_update( blake2sp_state *S, const byte *in, size_t inlen )
       S->ThPool->WaitDone();
 #endif // RAR_SMP
   }
+}
+
+
+void blake2sp_update( blake2sp_state *S, const byte *in, size_t inlen )
+{
+  size_t left = S->buflen;
+  size_t fill = sizeof( S->buf ) - left;
+
+  if( left && inlen >= fill )
+  {
+    memcpy( S->buf + left, in, fill );
+
+    for( size_t i = 0; i < PARALLELISM_DEGREE; ++i )
+      blake2s_update( &S->S[i], S->buf + i * BLAKE2S_BLOCKBYTES, BLAKE2S_BLOCKBYTES );
+
+    in += fill;
+    inlen -= fill;
+    left = 0;
+  }
+
+#ifdef USE_SSE
+  // AVX2 processes all 8 lanes in single thread faster than separate
+  // threads for every lane, so we do not use the thread pool here.
+  if (_SSE_Version>=SSE_AVX2 && inlen>=PARALLELISM_DEGREE * BLAKE2S_BLOCKBYTES)
+  {
+    size_t Count=inlen / ( PARALLELISM_DEGREE * BLAKE2S_BLOCKBYTES );
+    if ((_CPU_Features & CPUF_AVX512)!=0)
+      blake2sp_update_avx512( S, in, Count );
+    else
+      blake2sp_update_avx2( S, in, Count );
+  }
+  else
+#endif
+    blake2sp_update_lanes( S, in, inlen );
 
   in += inlen - inlen % ( PARALLELISM_DEGREE * BLAKE2S_BLOCKBYTES );
   inlen %= PARALLELISM_DEGREE * BLAKE2S_BLOCKBYTES;
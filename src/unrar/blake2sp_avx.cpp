@@ -0,0 +1,186 @@
+// 8 lane BLAKE2sp compression, where every lane of 256 bit AVX register
+// stores a 32 bit word of different BLAKE2s state. This file is included
+// from blake2sp.cpp twice to compile AVX2 and AVX-512 versions of code.
+// BLAKE_AVX_TARGET, BLAKE_AVX_NAME and for AVX-512 also BLAKE_AVX512
+// must be defined before including it.
+
+
+#ifdef BLAKE_AVX512
+// AVX-512 provides the single instruction cyclic rotation.
+#define mm256_rotr_epi32(r, c) _mm256_ror_epi32(r, c)
+#else
+#define mm256_rotr_epi32(r, c) ( \
+                c==8 ? _mm256_shuffle_epi8(r,_mm256_setr_epi8( \
+                  1,2,3,0,5,6,7,4,9,10,11,8,13,14,15,12,1,2,3,0,5,6,7,4,9,10,11,8,13,14,15,12)) \
+              : c==16 ? _mm256_shuffle_epi8(r,_mm256_setr_epi8( \
+                  2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13,2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13)) \
+              : _mm256_or_si256(_mm256_srli_epi32( (r), c ),_mm256_slli_epi32( (r), 32-c )) )
+#endif
+
+#define AVX_G(r,i,a,b,c,d) \
+  a = _mm256_add_epi32( _mm256_add_epi32( a, b ), m[blake2s_sigma[r][2*i+0]] ); \
+  d = mm256_rotr_epi32( _mm256_xor_si256( d, a ), 16 ); \
+  c = _mm256_add_epi32( c, d ); \
+  b = mm256_rotr_epi32( _mm256_xor_si256( b, c ), 12 ); \
+  a = _mm256_add_epi32( _mm256_add_epi32( a, b ), m[blake2s_sigma[r][2*i+1]] ); \
+  d = mm256_rotr_epi32( _mm256_xor_si256( d, a ), 8 ); \
+  c = _mm256_add_epi32( c, d ); \
+  b = mm256_rotr_epi32( _mm256_xor_si256( b, c ), 7 );
+
+#define AVX_ROUND(r) \
+  AVX_G(r,0,v[ 0],v[ 4],v[ 8],v[12]); \
+  AVX_G(r,1,v[ 1],v[ 5],v[ 9],v[13]); \
+  AVX_G(r,2,v[ 2],v[ 6],v[10],v[14]); \
+  AVX_G(r,3,v[ 3],v[ 7],v[11],v[15]); \
+  AVX_G(r,4,v[ 0],v[ 5],v[10],v[15]); \
+  AVX_G(r,5,v[ 1],v[ 6],v[11],v[12]); \
+  AVX_G(r,6,v[ 2],v[ 7],v[ 8],v[13]); \
+  AVX_G(r,7,v[ 3],v[ 4],v[ 9],v[14]);
+
+
+// Load 8 words at Offset of every lane block, so every register
+// contains the same message word for all 8 lanes.
+SSE_FUNCTION(BLAKE_AVX_TARGET)
+static inline void BLAKE_AVX_NAME(blake2sp_load_words)( __m256i *m, const byte **block, size_t Offset )
+{
+  __m256i r[8];
+  for ( uint i = 0; i < 8; i++ )
+    r[i] = _mm256_loadu_si256( (__m256i *)( block[i] + Offset ) );
+
+  __m256i t0 = _mm256_unpacklo_epi32( r[0], r[1] );
+  __m256i t1 = _mm256_unpackhi_epi32( r[0], r[1] );
+  __m256i t2 = _mm256_unpacklo_epi32( r[2], r[3] );
+  __m256i t3 = _mm256_unpackhi_epi32( r[2], r[3] );
+  __m256i t4 = _mm256_unpacklo_epi32( r[4], r[5] );
+  __m256i t5 = _mm256_unpackhi_epi32( r[4], r[5] );
+  __m256i t6 = _mm256_unpacklo_epi32( r[6], r[7] );
+  __m256i t7 = _mm256_unpackhi_epi32( r[6], r[7] );
+
+  __m256i u0 = _mm256_unpacklo_epi64( t0, t2 );
+  __m256i u1 = _mm256_unpackhi_epi64( t0, t2 );
+  __m256i u2 = _mm256_unpacklo_epi64( t1, t3 );
+  __m256i u3 = _mm256_unpackhi_epi64( t1, t3 );
+  __m256i u4 = _mm256_unpacklo_epi64( t4, t6 );
+  __m256i u5 = _mm256_unpackhi_epi64( t4, t6 );
+  __m256i u6 = _mm256_unpacklo_epi64( t5, t7 );
+  __m256i u7 = _mm256_unpackhi_epi64( t5, t7 );
+
+  m[0] = _mm256_permute2x128_si256( u0, u4, 0x20 );
+  m[1] = _mm256_permute2x128_si256( u1, u5, 0x20 );
+  m[2] = _mm256_permute2x128_si256( u2, u6, 0x20 );
+  m[3] = _mm256_permute2x128_si256( u3, u7, 0x20 );
+  m[4] = _mm256_permute2x128_si256( u0, u4, 0x31 );
+  m[5] = _mm256_permute2x128_si256( u1, u5, 0x31 );
+  m[6] = _mm256_permute2x128_si256( u2, u6, 0x31 );
+  m[7] = _mm256_permute2x128_si256( u3, u7, 0x31 );
+}
+
+
+// Process Count of 8 * BLAKE2S_BLOCKBYTES input chunks in all 8 lanes.
+// Lanes must have the same number of buffered bytes, which is always true
+// for blake2sp_update, because it feeds lanes with whole blocks only.
+SSE_FUNCTION(BLAKE_AVX_TARGET)
+static void BLAKE_AVX_NAME(blake2sp_update)( blake2sp_state *S, const byte *in, size_t Count )
+{
+  // Similarly to blake2s_update, every lane keeps up to 2 last blocks
+  // in its buffer and compresses them only if more data is available,
+  // so the last block can be processed by blake2s_final.
+  size_t Buffered = S->S[0].buflen / BLAKE2S_BLOCKBYTES;
+  size_t Total = Buffered + Count;
+  size_t Left = Min( Total, 2 );
+  size_t Compress = Total - Left;
+
+  uint32 lane[8];
+  __m256i h[8], t0, t1, f0, f1;
+  for ( uint i = 0; i < 8; i++ )
+  {
+    for ( uint j = 0; j < PARALLELISM_DEGREE; j++ )
+      lane[j] = S->S[j].h[i];
+    h[i] = _mm256_loadu_si256( (__m256i *)lane );
+  }
+#define LOAD_LANES(x,field) \
+  for ( uint j = 0; j < PARALLELISM_DEGREE; j++ ) \
+    lane[j] = S->S[j].field; \
+  x = _mm256_loadu_si256( (__m256i *)lane );
+
+  LOAD_LANES(t0,t[0]);
+  LOAD_LANES(t1,t[1]);
+  LOAD_LANES(f0,f[0]);
+  LOAD_LANES(f1,f[1]);
+#undef LOAD_LANES
+
+  const byte *block[PARALLELISM_DEGREE];
+  for ( size_t k = 0; k < Compress; k++ )
+  {
+    for ( uint j = 0; j < PARALLELISM_DEGREE; j++ )
+      block[j] = k < Buffered ? S->S[j].buf + k * BLAKE2S_BLOCKBYTES :
+                 in + ( k - Buffered ) * PARALLELISM_DEGREE * BLAKE2S_BLOCKBYTES + j * BLAKE2S_BLOCKBYTES;
+
+    __m256i m[16];
+    BLAKE_AVX_NAME(blake2sp_load_words)( m, block, 0 );
+    BLAKE_AVX_NAME(blake2sp_load_words)( m + 8, block, 32 );
+
+    // Increment 64 bit counter. Low part is less than block size
+    // after addition only if it overflowed.
+    const __m256i inc = _mm256_set1_epi32( BLAKE2S_BLOCKBYTES );
+    t0 = _mm256_add_epi32( t0, inc );
+    __m256i carry = _mm256_cmpeq_epi32( _mm256_min_epu32( t0, _mm256_set1_epi32( BLAKE2S_BLOCKBYTES - 1 ) ), t0 );
+    t1 = _mm256_sub_epi32( t1, carry );
+
+    __m256i v[16];
+    for ( uint i = 0; i < 8; i++ )
+      v[i] = h[i];
+    v[ 8] = _mm256_set1_epi32( blake2s_IV[0] );
+    v[ 9] = _mm256_set1_epi32( blake2s_IV[1] );
+    v[10] = _mm256_set1_epi32( blake2s_IV[2] );
+    v[11] = _mm256_set1_epi32( blake2s_IV[3] );
+    v[12] = _mm256_xor_si256( t0, _mm256_set1_epi32( blake2s_IV[4] ) );
+    v[13] = _mm256_xor_si256( t1, _mm256_set1_epi32( blake2s_IV[5] ) );
+    v[14] = _mm256_xor_si256( f0, _mm256_set1_epi32( blake2s_IV[6] ) );
+    v[15] = _mm256_xor_si256( f1, _mm256_set1_epi32( blake2s_IV[7] ) );
+
+    AVX_ROUND( 0 );
+    AVX_ROUND( 1 );
+    AVX_ROUND( 2 );
+    AVX_ROUND( 3 );
+    AVX_ROUND( 4 );
+    AVX_ROUND( 5 );
+    AVX_ROUND( 6 );
+    AVX_ROUND( 7 );
+    AVX_ROUND( 8 );
+    AVX_ROUND( 9 );
+
+    for ( uint i = 0; i < 8; i++ )
+      h[i] = _mm256_xor_si256( h[i], _mm256_xor_si256( v[i], v[i + 8] ) );
+  }
+
+  for ( uint i = 0; i < 8; i++ )
+  {
+    _mm256_storeu_si256( (__m256i *)lane, h[i] );
+    for ( uint j = 0; j < PARALLELISM_DEGREE; j++ )
+      S->S[j].h[i] = lane[j];
+  }
+  _mm256_storeu_si256( (__m256i *)lane, t0 );
+  for ( uint j = 0; j < PARALLELISM_DEGREE; j++ )
+    S->S[j].t[0] = lane[j];
+  _mm256_storeu_si256( (__m256i *)lane, t1 );
+  for ( uint j = 0; j < PARALLELISM_DEGREE; j++ )
+    S->S[j].t[1] = lane[j];
+
+  // Move not compressed blocks to lane buffers. If source block is already
+  // in buffer, it is never located before destination, so memmove is safe.
+  for ( uint j = 0; j < PARALLELISM_DEGREE; j++ )
+  {
+    for ( size_t k = Compress; k < Total; k++ )
+    {
+      const byte *src = k < Buffered ? S->S[j].buf + k * BLAKE2S_BLOCKBYTES :
+                        in + ( k - Buffered ) * PARALLELISM_DEGREE * BLAKE2S_BLOCKBYTES + j * BLAKE2S_BLOCKBYTES;
+      memmove( S->S[j].buf + ( k - Compress ) * BLAKE2S_BLOCKBYTES, src, BLAKE2S_BLOCKBYTES );
+    }
+    S->S[j].buflen = Left * BLAKE2S_BLOCKBYTES;
+  }
+}
+
+#undef mm256_rotr_epi32
+#undef AVX_G
+#undef AVX_ROUND
@@ -14,44 +14,51 @@
 
 #include "rar.hpp"
 
-static uint crc_tables[8][256]; // Tables for Slicing-by-8.
+// Tables for Slicing-by-8. We build them in compile time, so they are
+// placed to read-only data section and do not need initialization
+// when loading the library.
+struct CRCTables
+{
+  uint Tab[8][256];
+
+  constexpr CRCTables() : Tab()
+  {
+    // Build the classic CRC32 lookup table.
+    for (uint I=0;I<256;I++)
+    {
+      uint C=I;
+      for (uint J=0;J<8;J++)
+        C=(C & 1) ? (C>>1)^0xEDB88320 : (C>>1);
+      Tab[0][I]=C;
+    }
 
+    for (uint I=0;I<256;I++) // Build additional lookup tables.
+    {
+      uint C=Tab[0][I];
+      for (uint J=1;J<8;J++)
+      {
+        C=Tab[0][(byte)C]^(C>>8);
+        Tab[J][I]=C;
+      }
+    }
+  }
+};
 
-// Build the classic CRC32 lookup table.
+static constexpr CRCTables crc_tables_data;
+static const uint (&crc_tables)[8][256]=crc_tables_data.Tab;
+
+
+// Copy the classic CRC32 lookup table.
 // We also provide this function to legacy RAR and ZIP decryption code.
 void InitCRC32(uint *CRCTab)
 {
   if (CRCTab[1]!=0)
     return;
-  for (uint I=0;I<256;I++)
-  {
-    uint C=I;
-    for (uint J=0;J<8;J++)
-      C=(C & 1) ? (C>>1)^0xEDB88320 : (C>>1);
-    CRCTab[I]=C;
-  }
+  memcpy(CRCTab,crc_tables[0],sizeof(crc_tables[0]));
 }
 
 
-static void InitTables()
-{
-  InitCRC32(crc_tables[0]);
-
-  for (uint I=0;I<256;I++) // Build additional lookup tables.
-  {
-    uint C=crc_tables[0][I];
-    for (uint J=1;J<8;J++)
-    {
-      C=crc_tables[0][(byte)C]^(C>>8);
-      crc_tables[J][I]=C;
-    }
-  }
-}
-
-
-struct CallInitCRC {CallInitCRC() {InitTables();}} static CallInit32;
-
-uint CRC32(uint StartCRC,const void *Addr,size_t Size)
+static uint CRC32_Slice8(uint StartCRC,const void *Addr,size_t Size)
 {
   byte *Data=(byte *)Addr;
 
@@ -85,6 +92,284 @@ uint CRC32(uint StartCRC,const void *Addr,size_t Size)
 }
 
 
+
+#ifdef USE_SSE
+// CRC32 folding with carry-less multiplication based on Intel paper
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+// Constants are x^(N+32) mod P and x^(N-32) mod P bit reflected values
+// for folding distances N 1024, 512, 256 and 128 bits, x^64 mod P and
+// Barrett reduction constants. Low 64 bits of every pair are multiplied by
+// low 64 bits of data and high by high.
+static const uint64 CRC_K1024[2]={0x1e88ef372,0x14a7fe880};
+static const uint64 CRC_K512[2] ={0x154442bd4,0x1c6e41596};
+static const uint64 CRC_K256[2] ={0x0f1da05aa,0x15a546366};
+static const uint64 CRC_K128[2] ={0x1751997d0,0x0ccaa009e};
+static const uint64 CRC_K64=0x163cd6124;
+static const uint64 CRC_Poly[2] ={0x1db710641,0x1f7011641}; // P' and u.
+
+
+SSE_FUNCTION("pclmul")
+static inline __m128i CRC32_Fold(__m128i Data,__m128i K)
+{
+  return _mm_xor_si128(_mm_clmulepi64_si128(Data,K,0x00),
+                       _mm_clmulepi64_si128(Data,K,0x11));
+}
+
+
+// Reduce 128 bit folded value to 32 bit CRC.
+SSE_FUNCTION("pclmul")
+static inline uint CRC32_Reduce(__m128i X)
+{
+  const __m128i Mask32=_mm_setr_epi32(-1,0,-1,0);
+  __m128i K=_mm_loadu_si128((__m128i *)CRC_K128);
+
+  // Fold 128 bits to 64 and append 32 zero bits.
+  X=_mm_xor_si128(_mm_clmulepi64_si128(K,X,0x01),_mm_srli_si128(X,8));
+
+  // Fold 64 bits to 32.
+  K=_mm_cvtsi64_si128(CRC_K64);
+  X=_mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(X,Mask32),K,0x00),
+                  _mm_srli_si128(X,4));
+
+  // Barrett reduction of remaining 64 bits to 32 bit CRC.
+  K=_mm_loadu_si128((__m128i *)CRC_Poly);
+  __m128i T=_mm_clmulepi64_si128(_mm_and_si128(X,Mask32),K,0x10);
+  T=_mm_clmulepi64_si128(_mm_and_si128(T,Mask32),K,0x00);
+  X=_mm_xor_si128(X,T);
+  return (uint)_mm_cvtsi128_si32(_mm_srli_si128(X,4));
+}
+
+
+// Size must be multiple of 16 and not less than 64.
+SSE_FUNCTION("pclmul")
+static uint CRC32_CLMUL(uint StartCRC,const byte *Data,size_t Size)
+{
+  __m128i *D=(__m128i *)Data;
+  __m128i X0=_mm_xor_si128(_mm_loadu_si128(D),_mm_cvtsi32_si128(StartCRC));
+  __m128i X1=_mm_loadu_si128(D+1);
+  __m128i X2=_mm_loadu_si128(D+2);
+  __m128i X3=_mm_loadu_si128(D+3);
+  D+=4;
+  Size-=64;
+
+  __m128i K=_mm_loadu_si128((__m128i *)CRC_K512);
+  for (;Size>=64;Size-=64,D+=4)
+  {
+    X0=_mm_xor_si128(CRC32_Fold(X0,K),_mm_loadu_si128(D));
+    X1=_mm_xor_si128(CRC32_Fold(X1,K),_mm_loadu_si128(D+1));
+    X2=_mm_xor_si128(CRC32_Fold(X2,K),_mm_loadu_si128(D+2));
+    X3=_mm_xor_si128(CRC32_Fold(X3,K),_mm_loadu_si128(D+3));
+  }
+
+  K=_mm_loadu_si128((__m128i *)CRC_K128);
+  X1=_mm_xor_si128(CRC32_Fold(X0,K),X1);
+  X2=_mm_xor_si128(CRC32_Fold(X1,K),X2);
+  X0=_mm_xor_si128(CRC32_Fold(X2,K),X3);
+
+  for (;Size>=16;Size-=16,D++)
+    X0=_mm_xor_si128(CRC32_Fold(X0,K),_mm_loadu_si128(D));
+
+  return CRC32_Reduce(X0);
+}
+
+
+// VPCLMULQDQ version processing 128 bytes per iteration.
+// Size must be multiple of 16 and not less than 256.
+SSE_FUNCTION("avx2,vpclmulqdq,pclmul")
+static uint CRC32_VCLMUL(uint StartCRC,const byte *Data,size_t Size)
+{
+  __m256i *D=(__m256i *)Data;
+  __m256i Y0=_mm256_xor_si256(_mm256_loadu_si256(D),
+             _mm256_zextsi128_si256(_mm_cvtsi32_si128(StartCRC)));
+  __m256i Y1=_mm256_loadu_si256(D+1);
+  __m256i Y2=_mm256_loadu_si256(D+2);
+  __m256i Y3=_mm256_loadu_si256(D+3);
+  D+=4;
+  Size-=128;
+
+  __m256i K=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)CRC_K1024));
+  for (;Size>=128;Size-=128,D+=4)
+  {
+    Y0=_mm256_xor_si256(_mm256_xor_si256(_mm256_clmulepi64_epi128(Y0,K,0x00),
+       _mm256_clmulepi64_epi128(Y0,K,0x11)),_mm256_loadu_si256(D));
+    Y1=_mm256_xor_si256(_mm256_xor_si256(_mm256_clmulepi64_epi128(Y1,K,0x00),
+       _mm256_clmulepi64_epi128(Y1,K,0x11)),_mm256_loadu_si256(D+1));
+    Y2=_mm256_xor_si256(_mm256_xor_si256(_mm256_clmulepi64_epi128(Y2,K,0x00),
+       _mm256_clmulepi64_epi128(Y2,K,0x11)),_mm256_loadu_si256(D+2));
+    Y3=_mm256_xor_si256(_mm256_xor_si256(_mm256_clmulepi64_epi128(Y3,K,0x00),
+       _mm256_clmulepi64_epi128(Y3,K,0x11)),_mm256_loadu_si256(D+3));
+  }
+
+  K=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)CRC_K256));
+  Y1=_mm256_xor_si256(_mm256_xor_si256(_mm256_clmulepi64_epi128(Y0,K,0x00),
+     _mm256_clmulepi64_epi128(Y0,K,0x11)),Y1);
+  Y2=_mm256_xor_si256(_mm256_xor_si256(_mm256_clmulepi64_epi128(Y1,K,0x00),
+     _mm256_clmulepi64_epi128(Y1,K,0x11)),Y2);
+  Y0=_mm256_xor_si256(_mm256_xor_si256(_mm256_clmulepi64_epi128(Y2,K,0x00),
+     _mm256_clmulepi64_epi128(Y2,K,0x11)),Y3);
+
+  // Fold lower 128 bits of 256 bit value to higher.
+  __m128i K128=_mm_loadu_si128((__m128i *)CRC_K128);
+  __m128i X0=_mm_xor_si128(CRC32_Fold(_mm256_castsi256_si128(Y0),K128),
+                           _mm256_extracti128_si256(Y0,1));
+
+  __m128i *D128=(__m128i *)D;
+  for (;Size>=16;Size-=16,D128++)
+    X0=_mm_xor_si128(CRC32_Fold(X0,K128),_mm_loadu_si128(D128));
+
+  return CRC32_Reduce(X0);
+}
+#endif
+
+
+#ifdef USE_NEON_PMULL
+// ARMv8 version of CRC32_CLMUL above. Same constants and folding scheme.
+static const uint64 CRC_K512[2] ={0x154442bd4,0x1c6e41596};
+static const uint64 CRC_K128[2] ={0x1751997d0,0x0ccaa009e};
+static const uint64 CRC_K64=0x163cd6124;
+static const uint64 CRC_Poly[2] ={0x1db710641,0x1f7011641}; // P' and u.
+
+
+static inline uint64x2_t CRC32_PMull(uint64 A,uint64 B)
+{
+  return vreinterpretq_u64_p128(vmull_p64((poly64_t)A,(poly64_t)B));
+}
+
+
+static inline uint64x2_t CRC32_Fold(uint64x2_t Data,uint64x2_t K)
+{
+  uint64x2_t Low=CRC32_PMull(vgetq_lane_u64(Data,0),vgetq_lane_u64(K,0));
+  uint64x2_t High=vreinterpretq_u64_p128(vmull_high_p64(
+                  vreinterpretq_p64_u64(Data),vreinterpretq_p64_u64(K)));
+  return veorq_u64(Low,High);
+}
+
+
+static inline uint64x2_t CRC32_Load(const byte *Data)
+{
+  return vreinterpretq_u64_u8(vld1q_u8(Data));
+}
+
+
+// Size must be multiple of 16 and not less than 64.
+static uint CRC32_PMULL(uint StartCRC,const byte *Data,size_t Size)
+{
+  uint64x2_t X0=veorq_u64(CRC32_Load(Data),vcombine_u64(vcreate_u64(StartCRC),vcreate_u64(0)));
+  uint64x2_t X1=CRC32_Load(Data+16);
+  uint64x2_t X2=CRC32_Load(Data+32);
+  uint64x2_t X3=CRC32_Load(Data+48);
+  Data+=64;
+  Size-=64;
+
+  uint64x2_t K=vld1q_u64(CRC_K512);
+  for (;Size>=64;Size-=64,Data+=64)
+  {
+    X0=veorq_u64(CRC32_Fold(X0,K),CRC32_Load(Data));
+    X1=veorq_u64(CRC32_Fold(X1,K),CRC32_Load(Data+16));
+    X2=veorq_u64(CRC32_Fold(X2,K),CRC32_Load(Data+32));
+    X3=veorq_u64(CRC32_Fold(X3,K),CRC32_Load(Data+48));
+  }
+
+  K=vld1q_u64(CRC_K128);
+  X1=veorq_u64(CRC32_Fold(X0,K),X1);
+  X2=veorq_u64(CRC32_Fold(X1,K),X2);
+  X0=veorq_u64(CRC32_Fold(X2,K),X3);
+
+  for (;Size>=16;Size-=16,Data+=16)
+    X0=veorq_u64(CRC32_Fold(X0,K),CRC32_Load(Data));
+
+  // Fold 128 bits to 64 and append 32 zero bits.
+  uint64x2_t Zero=vdupq_n_u64(0);
+  X0=veorq_u64(CRC32_PMull(vgetq_lane_u64(X0,0),CRC_K128[1]),
+               vcombine_u64(vget_high_u64(X0),vcreate_u64(0)));
+
+  // Fold 64 bits to 32.
+  uint64x2_t X32=vreinterpretq_u64_u8(vextq_u8(vreinterpretq_u8_u64(X0),vreinterpretq_u8_u64(Zero),4));
+  X0=veorq_u64(CRC32_PMull(vgetq_lane_u64(X0,0) & 0xffffffff,CRC_K64),X32);
+
+  // Barrett reduction of remaining 64 bits to 32 bit CRC.
+  uint64x2_t T=CRC32_PMull(vgetq_lane_u64(X0,0) & 0xffffffff,CRC_Poly[1]);
+  T=CRC32_PMull(vgetq_lane_u64(T,0) & 0xffffffff,CRC_Poly[0]);
+  X0=veorq_u64(X0,T);
+  return (uint)(vgetq_lane_u64(X0,0)>>32);
+}
+
+
+static bool IsPMULLSupported()
+{
+#ifdef __linux
+  return (getauxval(AT_HWCAP) & HWCAP_PMULL)!=0;
+#else
+  return true; // All 64-bit Apple ARM CPUs support PMULL.
+#endif
+}
+
+static bool PMULLSupported=IsPMULLSupported();
+#endif
+
+
+uint CRC32(uint StartCRC,const void *Addr,size_t Size)
+{
+  // Carry-less multiplication is more efficient than table based code
+  // only for not too small blocks, so we use it for 64 bytes and more.
+  // Data tail, which is not multiple of 16, is processed with tables.
+#ifdef USE_SSE
+  if (Size>=64 && (_CPU_Features & CPUF_PCLMUL)!=0)
+  {
+    size_t FoldSize=Size & ~(size_t)15;
+    if (FoldSize>=256 && _SSE_Version>=SSE_AVX2 && (_CPU_Features & CPUF_VPCLMUL)!=0)
+      StartCRC=CRC32_VCLMUL(StartCRC,(byte *)Addr,FoldSize);
+    else
+      StartCRC=CRC32_CLMUL(StartCRC,(byte *)Addr,FoldSize);
+    return CRC32_Slice8(StartCRC,(byte *)Addr+FoldSize,Size-FoldSize);
+  }
+#endif
+#ifdef USE_NEON_PMULL
+  if (Size>=64 && PMULLSupported)
+  {
+    size_t FoldSize=Size & ~(size_t)15;
+    StartCRC=CRC32_PMULL(StartCRC,(byte *)Addr,FoldSize);
+    return CRC32_Slice8(StartCRC,(byte *)Addr+FoldSize,Size-FoldSize);
+  }
+#endif
+  return CRC32_Slice8(StartCRC,Addr,Size);
+}
+
+
+// Multiply two polynomials modulo CRC32 polynomial. Both arguments and
+// result are bit reflected, so x^0 is represented by 0x80000000.
+static uint CRC32MulMod(uint A,uint B)
+{
+  uint Product=0;
+  for (uint Mask=0x80000000;Mask!=0;Mask>>=1)
+  {
+    if ((A & Mask)!=0)
+      Product^=B;
+    B=(B & 1) ? (B>>1)^0xEDB88320 : (B>>1);
+  }
+  return Product;
+}
+
+
+// Calculate CRC32 of concatenated data blocks using CRC32 of first block
+// and CRC32 of second block of Size2 length. If CRC1 is calculated
+// with 0xffffffff initial value and final inversion, CRC2 must be calculated
+// in the same way. If CRC1 is an intermediate CRC32 register value,
+// CRC2 must be calculated with zero initial value. So we can process
+// data blocks in parallel and merge the result.
+uint CRC32Combine(uint CRC1,uint CRC2,uint64 Size2)
+{
+  // Shift CRC1 by Size2 zero bytes, multiplying it by x^(Size2*8).
+  uint Power=0x00800000; // x^8, single zero byte.
+  for (;Size2!=0;Size2>>=1)
+  {
+    if ((Size2 & 1)!=0)
+      CRC1=CRC32MulMod(Power,CRC1);
+    Power=CRC32MulMod(Power,Power);
+  }
+  return CRC1^CRC2;
+}
+
 #ifndef SFX_MODULE
 // For RAR 1.4 archives in case somebody still has them.
 ushort Checksum14(ushort StartCRC,const void *Addr,size_t Size)
@@ -6,6 +6,7 @@
 void InitCRC32(uint *CRCTab);
 
 uint CRC32(uint StartCRC,const void *Addr,size_t Size);
+uint CRC32Combine(uint CRC1,uint CRC2,uint64 Size2);
 
 #ifndef SFX_MODULE
 ushort Checksum14(ushort StartCRC,const void *Addr,size_t Size);
@@ -1,6 +1,7 @@
 #include "rar.hpp"
 
 static int RarErrorToDll(RAR_EXIT ErrCode);
+static HANDLE OpenArchive(struct RAROpenArchiveDataEx *r,bool GlobalErrors);
 
 struct DataSet
 {
@@ -31,12 +32,20 @@ HANDLE PASCAL RAROpenArchive(struct RAROpenArchiveData *r)
 
 
 HANDLE PASCAL RAROpenArchiveEx(struct RAROpenArchiveDataEx *r)
+{
+  ErrHandler.Clean();
+  return OpenArchive(r,true);
+}
+
+
+// Parallel tasks pass GlobalErrors=false. They must not read the global
+// error state, which is modified by other tasks, so they rely on
+// DllError of their own CommandData only.
+static HANDLE OpenArchive(struct RAROpenArchiveDataEx *r,bool GlobalErrors)
 {
   DataSet *Data=NULL;
   try
   {
-    ErrHandler.Clean();
-
     r->OpenResult=0;
     Data=new DataSet;
     Data->Cmd.DllError=0;
@@ -82,7 +91,7 @@ HANDLE PASCAL RAROpenArchiveEx(struct RAROpenArchiveDataEx *r)
         r->OpenResult=Data->Cmd.DllError;
       else
       {
-        RAR_EXIT ErrCode=ErrHandler.GetErrorCode();
+        RAR_EXIT ErrCode=GlobalErrors ? ErrHandler.GetErrorCode():RARX_SUCCESS;
         if (ErrCode!=RARX_SUCCESS && ErrCode!=RARX_WARNING)
           r->OpenResult=RarErrorToDll(ErrCode);
         else
@@ -457,6 +466,247 @@ int PASCAL RARGetDllVersion()
 }
 
 
+int PASCAL RARRepairVolumesW(wchar_t *ArcName)
+{
+  try
+  {
+    ErrHandler.Clean();
+
+    CommandData Cmd;
+    Cmd.Overwrite=OVERWRITE_ALL;
+    Cmd.DisablePercentage=true;
+    Cmd.DisableDone=true;
+    // Not silent mode, so open errors are stored in ErrHandler.
+    if (RecVolumesRestore(&Cmd,ArcName,false))
+      return ERAR_SUCCESS;
+    RAR_EXIT ErrCode=ErrHandler.GetErrorCode();
+    return ErrCode!=RARX_SUCCESS && ErrCode!=RARX_WARNING ? RarErrorToDll(ErrCode):ERAR_BAD_DATA;
+  }
+  catch (std::bad_alloc&)
+  {
+    return ERAR_NO_MEMORY;
+  }
+  catch (RAR_EXIT ErrCode)
+  {
+    return RarErrorToDll(ErrCode);
+  }
+}
+
+
+// Files of non-solid volumes do not depend on each other, so we can test
+// files starting in different ranges of volumes in parallel. Every task
+// uses its own archive handle and stores test results of its files.
+struct VerifyTask
+{
+  wchar ArcName[NM]; // First volume of range.
+  uint VolCount;     // Number of volumes in range, 0 to process all volumes.
+  bool NewNumbering;
+  wchar *Password;
+  uint Threads;      // Decoding threads of this task.
+
+  StringList FileNames;
+  Array<int> Results;
+  int ErrCode; // Error, which stopped processing of range.
+};
+
+
+static int CALLBACK VerifyCallback(UINT msg,LPARAM UserData,LPARAM P1,LPARAM P2)
+{
+  VerifyTask *Task=(VerifyTask *)UserData;
+  switch(msg)
+  {
+    case UCM_NEEDPASSWORDW:
+      if (Task->Password==NULL)
+        return -1;
+      wcsncpyz((wchar *)P1,Task->Password,(size_t)P2);
+      return 1;
+    case UCM_CHANGEVOLUMEW:
+    case UCM_CHANGEVOLUME:
+      // Abort if next volume is missing.
+      return P2==RAR_VOL_ASK ? -1:0;
+    default:
+      return 0;
+  }
+}
+
+
+static THREAD_PROC(VerifyThread)
+{
+  VerifyTask *Task=(VerifyTask *)Data;
+  Task->ErrCode=ERAR_SUCCESS;
+
+  RAROpenArchiveDataEx r;
+  memset(&r,0,sizeof(r));
+  r.ArcNameW=Task->ArcName;
+  r.OpenMode=RAR_OM_EXTRACT;
+  r.Callback=VerifyCallback;
+  r.UserData=(LPARAM)Task;
+  // Tasks run in parallel, so they must not clean the global error state.
+  HANDLE hArc=OpenArchive(&r,false);
+  if (hArc==NULL)
+  {
+    Task->ErrCode=r.OpenResult;
+    return;
+  }
+  DataSet *Set=(DataSet *)hArc;
+#ifdef RAR_SMP
+  Set->Cmd.Threads=Task->Threads;
+  Set->Extract.SetThreads(Task->Threads);
+#endif
+
+  wchar VolName[NM];
+  wcsncpyz(VolName,Task->ArcName,ASIZE(VolName));
+  uint VolNum=0;
+  while (true)
+  {
+    RARHeaderDataEx D;
+    memset(&D,0,sizeof(D));
+    int Code=RARReadHeaderEx(hArc,&D);
+    if (Code!=ERAR_SUCCESS)
+    {
+      if (Code!=ERAR_END_ARCHIVE)
+        Task->ErrCode=Code;
+      break;
+    }
+    if (Task->VolCount!=0)
+    {
+      // Find the volume containing this header. Testing a split file
+      // can move us several volumes forward.
+      while (VolNum<Task->VolCount && wcscmp(VolName,Set->Arc.FileName)!=0)
+      {
+        NextVolumeName(VolName,ASIZE(VolName),!Task->NewNumbering);
+        VolNum++;
+      }
+      if (VolNum>=Task->VolCount) // Files of next range.
+        break;
+    }
+    if ((D.Flags & RHDF_SPLITBEFORE)!=0) // Tested by previous range task.
+    {
+      Code=RARProcessFile(hArc,RAR_SKIP,NULL,NULL);
+      if (Code!=ERAR_SUCCESS)
+      {
+        Task->ErrCode=Code;
+        break;
+      }
+    }
+    else
+    {
+      Code=RARProcessFile(hArc,RAR_TEST,NULL,NULL);
+      Task->FileNames.AddString(D.FileNameW);
+      Task->Results.Push(Code);
+    }
+  }
+  RARCloseArchive(hArc);
+}
+
+
+int PASCAL RARVerifyVolumesW(wchar_t *ArcName,wchar_t *Password,VERIFYFILEPROC VerifyFileProc,LPARAM UserData)
+{
+  VerifyTask *Tasks=NULL;
+  try
+  {
+    ErrHandler.Clean();
+
+    CommandData Cmd;
+    if (Password!=NULL)
+      Cmd.Password.Set(Password);
+    Archive Arc(&Cmd);
+    if (!Arc.WOpen(ArcName))
+      return ERAR_EOPEN;
+    if (!Arc.IsArchive(true))
+      return ERAR_BAD_ARCHIVE;
+    bool NewNumbering=Arc.NewNumbering;
+    // Solid files depend on previous files, so we test them in one task.
+    bool Parallel=Arc.Volume && !Arc.Solid;
+    Arc.Close();
+
+    uint VolCount=0;
+    wchar VolName[NM];
+    wcsncpyz(VolName,ArcName,ASIZE(VolName));
+    if (Parallel)
+      while (FileExist(VolName))
+      {
+        VolCount++;
+        NextVolumeName(VolName,ASIZE(VolName),!NewNumbering);
+      }
+
+#ifdef RAR_SMP
+    // Every task also decodes and hashes its files in several threads,
+    // so we split pool threads between tasks instead of running pool size
+    // tasks with pool size threads each.
+    uint PoolThreads=GetThreadPoolSize();
+    uint TaskCount=Min(PoolThreads,VolCount);
+#else
+    uint PoolThreads=1;
+    uint TaskCount=1;
+#endif
+    if (TaskCount==0)
+      TaskCount=1;
+    uint TaskThreads=Max(PoolThreads/TaskCount,1);
+    Tasks=new VerifyTask[TaskCount];
+
+    wcsncpyz(VolName,ArcName,ASIZE(VolName));
+    for (uint I=0;I<TaskCount;I++)
+    {
+      VerifyTask *Task=Tasks+I;
+      wcsncpyz(Task->ArcName,VolName,ASIZE(Task->ArcName));
+      Task->NewNumbering=NewNumbering;
+      Task->Password=Password;
+      Task->Threads=TaskThreads;
+      // Last task continues to the end of volume set.
+      Task->VolCount=I==TaskCount-1 ? 0:VolCount/TaskCount+(I<VolCount%TaskCount ? 1:0);
+      for (uint J=0;J<Task->VolCount;J++)
+        NextVolumeName(VolName,ASIZE(VolName),!NewNumbering);
+    }
+
+#ifdef RAR_SMP
+    if (TaskCount>1)
+    {
+      ThreadPool *Pool=CreateThreadPool();
+      for (uint I=0;I<TaskCount;I++)
+        Pool->AddTask(VerifyThread,(void*)(Tasks+I));
+      Pool->WaitDone();
+      DestroyThreadPool(Pool);
+    }
+    else
+      VerifyThread((void*)Tasks);
+#else
+    VerifyThread((void*)Tasks);
+#endif
+
+    // Report results in archive order and return the first error.
+    int Result=ERAR_SUCCESS;
+    for (uint I=0;I<TaskCount;I++)
+    {
+      VerifyTask *Task=Tasks+I;
+      Task->FileNames.Rewind();
+      for (size_t J=0;J<Task->Results.Size();J++)
+      {
+        wchar *FileName=Task->FileNames.GetString();
+        if (VerifyFileProc!=NULL)
+          VerifyFileProc(FileName,Task->Results[J],UserData);
+        if (Result==ERAR_SUCCESS)
+          Result=Task->Results[J];
+      }
+      if (Result==ERAR_SUCCESS)
+        Result=Task->ErrCode;
+    }
+    delete[] Tasks;
+    return Result;
+  }
+  catch (std::bad_alloc&)
+  {
+    delete[] Tasks;
+    return ERAR_NO_MEMORY;
+  }
+  catch (RAR_EXIT ErrCode)
+  {
+    delete[] Tasks;
+    return RarErrorToDll(ErrCode);
+  }
+}
+
+
 static int RarErrorToDll(RAR_EXIT ErrCode)
 {
   switch(ErrCode)
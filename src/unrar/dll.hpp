@@ -158,6 +158,7 @@ enum UNRARCALLBACK_MESSAGES {
 
 typedef int (PASCAL *CHANGEVOLPROC)(char *ArcName,int Mode);
 typedef int (PASCAL *PROCESSDATAPROC)(unsigned char *Addr,int Size);
+typedef void (CALLBACK *VERIFYFILEPROC)(wchar_t *FileName,int Result,LPARAM UserData);
 
 #ifdef __cplusplus
 extern "C" {
@@ -176,6 +177,8 @@ void   PASCAL RARSetProcessDataProc(HANDLE hArcData,PROCESSDATAPROC ProcessDataP
 void   PASCAL RARSetPassword(HANDLE hArcData,char *Password);
 void   PASCAL RARSetPasswordW(HANDLE hArcData,wchar *PasswordW);
 int    PASCAL RARGetDllVersion();
+int    PASCAL RARRepairVolumesW(wchar_t *ArcName);
+int    PASCAL RARVerifyVolumesW(wchar_t *ArcName,wchar_t *Password,VERIFYFILEPROC VerifyFileProc,LPARAM UserData);
 
 #ifdef __cplusplus
 }
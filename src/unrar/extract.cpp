@@ -668,7 +668,17 @@ bool CmdExtract::ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat)
             UnstoreFile(DataIO,Arc.FileHead.UnpSize);
           else
           {
-            Unp->Init(Arc.FileHead.WinSize,Arc.FileHead.Solid);
+            size_t WinSize=Arc.FileHead.WinSize;
+
+            // File in non-solid archive cannot refer to data preceding it,
+            // so we do not need the window larger than the file itself.
+            // It reduces memory usage when extracting small files packed
+            // with large dictionary.
+            if (!Arc.Solid && !Arc.FileHead.Solid && !Arc.FileHead.UnknownUnpSize)
+              while (WinSize>0x40000 && int64(WinSize/2)>=Arc.FileHead.UnpSize)
+                WinSize/=2;
+
+            Unp->Init(WinSize,Arc.FileHead.Solid);
             Unp->SetDestSize(Arc.FileHead.UnpSize);
 #ifndef SFX_MODULE
             if (Arc.Format!=RARFMT50 && Arc.FileHead.UnpVer<=15)
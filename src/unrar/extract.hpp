@@ -56,6 +56,9 @@ class CmdExtract
     void DoExtract();
     void ExtractArchiveInit(Archive &Arc);
     bool ExtractCurrentFile(Archive &Arc,size_t HeaderSize,bool &Repeat);
+#ifdef RAR_SMP
+    void SetThreads(uint Threads) {Unp->SetThreads(Threads);}
+#endif
     static void UnstoreFile(ComprDataIO &DataIO,int64 DestUnpSize);
 };
 
@@ -33,10 +33,16 @@ class BitInput
     // Bit at (InAddr,InBit) has the highest position in returning data.
     uint getbits()
     {
+#ifdef USE_MEM_BYTESWAP
+      // Single unaligned load is faster than assembling separate bytes.
+      uint BitField=RawGetBE4(InBuf+InAddr);
+      BitField >>= (16-InBit);
+#else
       uint BitField=(uint)InBuf[InAddr] << 16;
       BitField|=(uint)InBuf[InAddr+1] << 8;
       BitField|=(uint)InBuf[InAddr+2];
       BitField >>= (8-InBit);
+#endif
       return BitField & 0xffff;
     }
 
@@ -44,6 +50,9 @@ class BitInput
     // Bit at (InAddr,InBit) has the highest position in returning data.
     uint getbits32()
     {
+#ifdef USE_MEM_BYTESWAP
+      return uint(RawGetBE8(InBuf+InAddr) >> (32-InBit));
+#else
       uint BitField=(uint)InBuf[InAddr] << 24;
       BitField|=(uint)InBuf[InAddr+1] << 16;
       BitField|=(uint)InBuf[InAddr+2] << 8;
@@ -51,6 +60,7 @@ class BitInput
       BitField <<= InBit;
       BitField|=(uint)InBuf[InAddr+4] >> (8-InBit);
       return BitField & 0xffffffff;
+#endif
     }
     
     void faddbits(uint Bits);
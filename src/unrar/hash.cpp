@@ -88,7 +88,14 @@ void DataHash::Update(const void *Data,size_t DataSize)
     CurCRC32=Checksum14((ushort)CurCRC32,Data,DataSize);
 #endif
   if (HashType==HASH_CRC32)
-    CurCRC32=CRC32(CurCRC32,Data,DataSize);
+  {
+#ifdef RAR_SMP
+    if (MaxThreads>1 && DataSize>=2*MinCRC32ThreadSize)
+      UpdateCRC32MT(Data,DataSize);
+    else
+#endif
+      CurCRC32=CRC32(CurCRC32,Data,DataSize);
+  }
 
   if (HashType==HASH_BLAKE2)
   {
@@ -103,6 +110,49 @@ void DataHash::Update(const void *Data,size_t DataSize)
 }
 
 
+#ifdef RAR_SMP
+struct CRC32ThreadData
+{
+  const byte *Data;
+  size_t DataSize;
+  uint DataCRC;
+};
+
+
+THREAD_PROC(BuildCRC32Thread)
+{
+  CRC32ThreadData *td=(CRC32ThreadData *)Data;
+
+  // Use 0 initial value to not depend on data before this block.
+  td->DataCRC=CRC32(0,td->Data,td->DataSize);
+}
+
+
+// Split the data to chunks, calculate their CRC32 in parallel
+// and merge results.
+void DataHash::UpdateCRC32MT(const void *Data,size_t DataSize)
+{
+  if (ThPool==NULL)
+    ThPool=CreateThreadPool();
+
+  size_t ThreadNumber=Min(DataSize/MinCRC32ThreadSize,(size_t)MaxThreads);
+  size_t ChunkSize=DataSize/ThreadNumber;
+
+  CRC32ThreadData td[MaxHashThreads];
+  for (size_t I=0;I<ThreadNumber;I++)
+  {
+    td[I].Data=(byte *)Data+I*ChunkSize;
+    td[I].DataSize=I==ThreadNumber-1 ? DataSize-I*ChunkSize : ChunkSize;
+    ThPool->AddTask(BuildCRC32Thread,(void*)&td[I]);
+  }
+  ThPool->WaitDone();
+
+  for (size_t I=0;I<ThreadNumber;I++)
+    CurCRC32=CRC32Combine(CurCRC32,td[I].DataCRC,td[I].DataSize);
+}
+#endif
+
+
 void DataHash::Result(HashValue *Result)
 {
   Result->Type=HashType;
@@ -27,6 +27,8 @@ class DataHash;
 class DataHash
 {
   private:
+    void UpdateCRC32MT(const void *Data,size_t DataSize);
+
     HASH_TYPE HashType;
     uint CurCRC32;
     blake2sp_state *blake2ctx;
@@ -37,6 +39,10 @@ class DataHash
     uint MaxThreads;
     // Upper limit for maximum threads to prevent wasting threads in pool.
     static const uint MaxHashThreads=8;
+
+    // Minimum data size processed by single thread when calculating CRC32.
+    // Smaller chunks are calculated faster than thread switching is done.
+    static const size_t MinCRC32ThreadSize=0x40000;
 #endif
   public:
     DataHash();
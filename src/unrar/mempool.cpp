@@ -0,0 +1,232 @@
+#include "rar.hpp"
+
+static size_t PoolLimit=0x10000000;
+static bool PoolHugePages=false;
+
+#ifdef RAR_SMP
+// Unpack objects request only a few different block sizes,
+// so we do not need many entries here.
+static const uint MaxPoolBlocks=64;
+
+struct MemPoolBlock
+{
+  void *Mem;
+  size_t Size;
+  MEMPOOL_FREE FreeProc;
+};
+
+
+struct MemPoolData
+{
+  MemPoolBlock Blocks[MaxPoolBlocks]; // Ordered from oldest to newest.
+  uint Count;
+  size_t CachedSize;
+  CRITSECT_HANDLE CritSection;
+
+  MemPoolData()
+  {
+    Count=0;
+    CachedSize=0;
+#ifdef _UNIX
+    pthread_mutex_init(&CritSection,NULL);
+#else
+    InitializeCriticalSection(&CritSection);
+#endif
+  }
+  void Lock()
+  {
+#ifdef _UNIX
+    pthread_mutex_lock(&CritSection);
+#else
+    EnterCriticalSection(&CritSection);
+#endif
+  }
+  void Unlock()
+  {
+#ifdef _UNIX
+    pthread_mutex_unlock(&CritSection);
+#else
+    LeaveCriticalSection(&CritSection);
+#endif
+  }
+
+  // Remove oldest blocks until NewSize bytes can be added to cache.
+  // Removed blocks are stored to Evicted and must be released by caller
+  // after unlocking the pool.
+  uint Evict(size_t NewSize,MemPoolBlock *Evicted)
+  {
+    uint EvictCount=0;
+    while (EvictCount<Count && (CachedSize+NewSize>PoolLimit ||
+           (NewSize>0 && Count-EvictCount>=MaxPoolBlocks)))
+    {
+      CachedSize-=Blocks[EvictCount].Size;
+      Evicted[EvictCount]=Blocks[EvictCount];
+      EvictCount++;
+    }
+    Count-=EvictCount;
+    memmove(Blocks,Blocks+EvictCount,Count*sizeof(Blocks[0]));
+    return EvictCount;
+  }
+};
+
+
+// Pool is never destroyed, because blocks can be returned to it
+// by destructors of other static objects after exit() call.
+// Cached blocks are released by OS at process termination.
+static MemPoolData& GetPool()
+{
+  static MemPoolData *Pool=new MemPoolData;
+  return *Pool;
+}
+#endif
+
+
+void* MemPoolGet(size_t Size,MEMPOOL_FREE FreeProc)
+{
+  void *Mem=NULL;
+#ifdef RAR_SMP
+  MemPoolData &Pool=GetPool();
+  Pool.Lock();
+  for (uint I=Pool.Count;I>0;I--) // Prefer recently used blocks.
+  {
+    MemPoolBlock *Block=Pool.Blocks+I-1;
+    if (Block->Size==Size && Block->FreeProc==FreeProc)
+    {
+      Mem=Block->Mem;
+      Pool.CachedSize-=Size;
+      Pool.Count--;
+      memmove(Block,Block+1,(Pool.Count-(I-1))*sizeof(*Block));
+      break;
+    }
+  }
+  Pool.Unlock();
+#endif
+  return Mem;
+}
+
+
+void MemPoolPut(void *Mem,size_t Size,MEMPOOL_FREE FreeProc)
+{
+  if (Mem==NULL)
+    return;
+#ifdef RAR_SMP
+  MemPoolBlock Evicted[MaxPoolBlocks];
+  uint EvictCount=0;
+  bool Cached=false;
+  MemPoolData &Pool=GetPool();
+  Pool.Lock();
+  if (Size<=PoolLimit)
+  {
+    EvictCount=Pool.Evict(Size,Evicted);
+    MemPoolBlock *Block=Pool.Blocks+Pool.Count++;
+    Block->Mem=Mem;
+    Block->Size=Size;
+    Block->FreeProc=FreeProc;
+    Pool.CachedSize+=Size;
+    Cached=true;
+  }
+  Pool.Unlock();
+  for (uint I=0;I<EvictCount;I++)
+    Evicted[I].FreeProc(Evicted[I].Mem,Evicted[I].Size);
+  if (Cached)
+    return;
+#endif
+  FreeProc(Mem,Size);
+}
+
+
+static void MemPoolFreeHeap(void *Mem,size_t)
+{
+  free(Mem);
+}
+
+
+void* MemPoolAlloc(size_t Size)
+{
+  void *Mem=MemPoolGet(Size,MemPoolFreeHeap);
+  return Mem!=NULL ? Mem:malloc(Size);
+}
+
+
+void MemPoolFree(void *Mem,size_t Size)
+{
+  MemPoolPut(Mem,Size,MemPoolFreeHeap);
+}
+
+
+// PoolLimit and PoolHugePages are read by other threads, so we access them
+// only inside of pool critical section.
+void SetMemPoolLimit(size_t Limit)
+{
+#ifdef RAR_SMP
+  MemPoolBlock Evicted[MaxPoolBlocks];
+  MemPoolData &Pool=GetPool();
+  Pool.Lock();
+  PoolLimit=Limit;
+  // Release cached blocks exceeding the new limit.
+  uint EvictCount=Pool.Evict(0,Evicted);
+  Pool.Unlock();
+  for (uint I=0;I<EvictCount;I++)
+    Evicted[I].FreeProc(Evicted[I].Mem,Evicted[I].Size);
+#else
+  PoolLimit=Limit;
+#endif
+}
+
+
+size_t GetMemPoolLimit()
+{
+#ifdef RAR_SMP
+  MemPoolData &Pool=GetPool();
+  Pool.Lock();
+  size_t Limit=PoolLimit;
+  Pool.Unlock();
+  return Limit;
+#else
+  return PoolLimit;
+#endif
+}
+
+
+void SetMemPoolHugePages(bool Enable)
+{
+#ifdef RAR_SMP
+  MemPoolData &Pool=GetPool();
+  Pool.Lock();
+  PoolHugePages=Enable;
+  Pool.Unlock();
+#else
+  PoolHugePages=Enable;
+#endif
+}
+
+
+bool GetMemPoolHugePages()
+{
+#ifdef RAR_SMP
+  MemPoolData &Pool=GetPool();
+  Pool.Lock();
+  bool Enable=PoolHugePages;
+  Pool.Unlock();
+  return Enable;
+#else
+  return PoolHugePages;
+#endif
+}
+
+
+void MemPoolAdvise(void *Mem,size_t Size)
+{
+#ifdef MADV_HUGEPAGE
+  if (GetMemPoolHugePages())
+  {
+    // Heap blocks are not page aligned, so we advise only whole pages
+    // inside of block.
+    size_t PageSize=(size_t)sysconf(_SC_PAGESIZE);
+    size_t Start=((size_t)Mem+PageSize-1) & ~(PageSize-1);
+    size_t End=((size_t)Mem+Size) & ~(PageSize-1);
+    if (Start<End)
+      madvise((void *)Start,End-Start,MADV_HUGEPAGE);
+  }
+#endif
+}
@@ -0,0 +1,37 @@
+#ifndef _RAR_MEMPOOL_
+#define _RAR_MEMPOOL_
+
+// Process-wide cache of large memory blocks, such as sliding dictionaries
+// and multithreaded unpack buffers. Blocks released by one Unpack object
+// are reused by following ones, so we do not need to allocate and fault in
+// the same memory again for every archive. Blocks are cached only
+// in multithreaded version, which has synchronization primitives.
+
+// Function releasing the block memory. It also identifies how the block
+// was allocated, so we reuse blocks only for requests with the same size
+// and release function.
+typedef void (*MEMPOOL_FREE)(void *Mem,size_t Size);
+
+// Take the cached block of specified size and type or return NULL.
+void* MemPoolGet(size_t Size,MEMPOOL_FREE FreeProc);
+
+// Return the block to cache or release it if cache limit is exceeded.
+void MemPoolPut(void *Mem,size_t Size,MEMPOOL_FREE FreeProc);
+
+// Heap allocated blocks, which can be resized with realloc.
+void* MemPoolAlloc(size_t Size);
+void MemPoolFree(void *Mem,size_t Size);
+
+// Set the maximum total size of cached blocks. 0 disables the cache
+// and releases all cached blocks.
+void SetMemPoolLimit(size_t Limit);
+size_t GetMemPoolLimit();
+
+// Request transparent huge pages for large blocks, such as sliding
+// dictionaries and PPMd model heap. It reduces the number of page faults
+// when accessing a new memory and TLB misses for random access.
+void SetMemPoolHugePages(bool Enable);
+bool GetMemPoolHugePages();
+void MemPoolAdvise(void *Mem,size_t Size);
+
+#endif
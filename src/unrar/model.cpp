@@ -8,6 +8,17 @@
 static const int MAX_O=64; /* maximum allowed model order */
 const uint TOP=1 << 24, BOT=1 << 15;
 
+// Model contexts are scattered over the large heap, so we often miss
+// the cache when following suffix and successor links. We request
+// contexts, which are likely to be accessed soon, in advance.
+#if defined(USE_SSE)
+#define PPM_PREFETCH(p) _mm_prefetch((const char *)(p),_MM_HINT_T0)
+#elif defined(__GNUC__)
+#define PPM_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PPM_PREFETCH(p)
+#endif
+
 template <class T>
 inline void _PPMD_SWAP(T& t1,T& t2) { T tmp=t1; t1=t2; t2=tmp; }
 
@@ -489,40 +500,32 @@ inline RARPPM_SEE2_CONTEXT* RARPPM_CONTEXT::makeEscFreq2(ModelPPM *Model,int Dif
 
 inline bool RARPPM_CONTEXT::decodeSymbol2(ModelPPM *Model)
 {
-  int count, HiCnt, i=NumStats-Model->NumMasked;
-  RARPPM_SEE2_CONTEXT* psee2c=makeEscFreq2(Model,i);
-  RARPPM_STATE* ps[256], ** pps=ps, * p=U.Stats-1;
-  HiCnt=0;
-  do 
-  {
-    do 
-    { 
-      p++; 
-    } while (Model->CharMask[p->Symbol] == Model->EscCount);
-    HiCnt += p->Freq;
-
-    // We do not reuse PPMd coder in unstable state, so we do not really need
-    // this check and added it for extra safety. See CVE-2017-17969 for details.
-    if (pps>=ps+ASIZE(ps))
-      return false;
+  // We do not reuse PPMd coder in unstable state, so we do not really need
+  // this check and added it for extra safety. See CVE-2017-17969 for details.
+  if (NumStats>256)
+    return false;
 
-    *pps++ = p;
-  } while ( --i );
+  int count, HiCnt=0, i=NumStats-Model->NumMasked;
+  RARPPM_SEE2_CONTEXT* psee2c=makeEscFreq2(Model,i);
+  RARPPM_STATE *p=U.Stats, *pEnd=U.Stats+NumStats;
+  byte EscCount=Model->EscCount;
+
+  // Masked symbols are already excluded in higher order contexts and
+  // randomly distributed here, so we calculate the frequency sum without
+  // branches instead of collecting unmasked states to array first.
+  // Escapes to order -1 context with 256 states make this loop critical
+  // for poorly compressible data.
+  for (;p<pEnd;p++)
+    HiCnt+=p->Freq & -(int)(Model->CharMask[p->Symbol]!=EscCount);
   Model->Coder.SubRange.scale += HiCnt;
   count=Model->Coder.GetCurrentCount();
   if (count>=(int)Model->Coder.SubRange.scale)
     return(false);
-  p=*(pps=ps);
   if (count < HiCnt) 
   {
     HiCnt=0;
-    while ((HiCnt += p->Freq) <= count) 
-    {
-      pps++;
-      if (pps>=ps+ASIZE(ps)) // Extra safety check.
-        return false;
-      p=*pps;
-    }
+    for (p=U.Stats;(HiCnt+=p->Freq & -(int)(Model->CharMask[p->Symbol]!=EscCount)) <= count;p++)
+      ;
     Model->Coder.SubRange.LowCount = (Model->Coder.SubRange.HighCount=HiCnt)-p->Freq;
     psee2c->update();
     update2(Model,p);
@@ -531,15 +534,8 @@ inline bool RARPPM_CONTEXT::decodeSymbol2(ModelPPM *Model)
   {
     Model->Coder.SubRange.LowCount=HiCnt;
     Model->Coder.SubRange.HighCount=Model->Coder.SubRange.scale;
-    i=NumStats-Model->NumMasked;
-    pps--;
-    do 
-    { 
-      pps++;
-      if (pps>=ps+ASIZE(ps)) // Extra safety check.
-        return false;
-      Model->CharMask[(*pps)->Symbol]=Model->EscCount; 
-    } while ( --i );
+    for (p=U.Stats;p<pEnd;p++)
+      Model->CharMask[p->Symbol]=EscCount;
     psee2c->Summ += Model->Coder.SubRange.scale;
     Model->NumMasked = NumStats;
   }
@@ -601,6 +597,8 @@ int ModelPPM::DecodeChar()
 {
   if ((byte*)MinContext <= SubAlloc.pText || (byte*)MinContext>SubAlloc.HeapEnd)
     return(-1);
+  // Suffix is used both when escaping and when updating the model.
+  PPM_PREFETCH(MinContext->Suffix);
   if (MinContext->NumStats != 1)      
   {
     if ((byte*)MinContext->U.Stats <= SubAlloc.pText || (byte*)MinContext->U.Stats>SubAlloc.HeapEnd)
@@ -626,6 +624,7 @@ int ModelPPM::DecodeChar()
     Coder.Decode();
   }
   int Symbol=FoundState->Symbol;
+  PPM_PREFETCH(FoundState->Successor);
   if (!OrderFall && (byte*) FoundState->Successor > SubAlloc.pText)
     MinContext=MaxContext=FoundState->Successor;
   else
@@ -27,7 +27,13 @@ void RAROptions::Init()
   FileSizeMore=INT64NDF;
   HashType=HASH_CRC32;
 #ifdef RAR_SMP
-  Threads=GetNumberOfThreads();
+  // Pool can have more threads than CPU cores to process several archives
+  // at once, but more threads for one archive only increase memory use.
+  // Tests use all pool threads to cover multithreaded code on any CPU.
+  Threads=GetThreadPoolSize();
+#ifndef RAR_TEST_HOOKS
+  Threads=Min(Threads,GetNumberOfThreads());
+#endif
 #endif
 #ifdef USE_QOPEN
   QOpenMode=QOPEN_AUTO;
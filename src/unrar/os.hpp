@@ -134,6 +134,19 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#if defined(__linux__) && defined(_LP64)
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  // Reserve large sliding dictionary as virtual address range and let
+  // the system to commit its pages on first access.
+  #define USE_MAPPED_WINDOW
+  #ifdef SYS_memfd_create
+    // Map the same sliding dictionary memory twice to adjacent addresses,
+    // so data crossing the window end can be accessed as continuous area.
+    // Requires large address space, so we enable it for 64-bit only.
+    #define USE_MIRROR_WINDOW
+  #endif
+#endif
 #if defined(__QNXNTO__)
   #include <sys/param.h>
 #endif
@@ -220,6 +233,39 @@
   typedef const wchar* MSGID;
 #endif
 
+#if !defined(_MSC_VER) && defined(__GNUC__) && defined(__x86_64__)
+  // Unlike MSVC, GCC and Clang allow SSE intrinsics only in functions
+  // compiled for appropriate instruction set. So we mark such functions
+  // with SSE_FUNCTION and check the CPU capabilities before calling them.
+  #include <x86intrin.h>
+
+  #define USE_SSE
+  #define SSE_ALIGNMENT 16
+  #define SSE_FUNCTION(Target) __attribute__((target(Target)))
+#endif
+
+#ifndef SSE_FUNCTION
+  #define SSE_FUNCTION(Target)
+#endif
+
+// ARMv8 polynomial multiplication is available only if we compile
+// for CPU with cryptography extension, but we still check for it in run time.
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES)) && \
+    (defined(__linux) || defined(__APPLE__))
+  #include <arm_neon.h>
+  #ifdef __linux
+    #include <sys/auxv.h>
+    #include <asm/hwcap.h>
+  #endif
+  #define USE_NEON_PMULL
+#endif
+
+// NEON is a mandatory part of ARMv8, so we can use it without run time check.
+#if defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+  #include <arm_neon.h>
+  #define USE_NEON
+#endif
+
 #ifndef SSE_ALIGNMENT // No SSE use and no special data alignment is required.
   #define SSE_ALIGNMENT 1
 #endif
@@ -40,7 +40,6 @@
 #include "find.hpp"
 #include "scantree.hpp"
 #include "savepos.hpp"
-#include "getbits.hpp"
 #include "rdwrfn.hpp"
 #ifdef USE_QOPEN
 #include "qopen.hpp"
@@ -53,6 +52,7 @@
 #include "system.hpp"
 #include "log.hpp"
 #include "rawint.hpp"
+#include "getbits.hpp"
 #include "rawread.hpp"
 #include "encname.hpp"
 #include "resource.hpp"
@@ -62,6 +62,7 @@
 #include "model.hpp"
 
 #include "threadpool.hpp"
+#include "mempool.hpp"
 
 #include "unpack.hpp"
 
@@ -199,18 +199,10 @@ bool RarVM::ExecuteStandardFilter(VM_StandardFilters FilterType)
       break;
     case VMSF_DELTA:
       {
-        uint DataSize=R[4],Channels=R[0],SrcPos=0,Border=DataSize*2;
+        uint DataSize=R[4],Channels=R[0];
         if (DataSize>VM_MEMSIZE/2 || Channels>MAX3_UNPACK_CHANNELS || Channels==0)
           return false;
-
-        // Bytes from same channels are grouped to continual data blocks,
-        // so we need to place them back to their interleaving positions.
-        for (uint CurChannel=0;CurChannel<Channels;CurChannel++)
-        {
-          byte PrevByte=0;
-          for (uint DestPos=DataSize+CurChannel;DestPos<Border;DestPos+=Channels)
-            Mem[DestPos]=(PrevByte-=Mem[SrcPos++]);
-        }
+        UnpackDeltaFilter(Mem+DataSize,Mem,DataSize,Channels);
       }
       break;
     case VMSF_RGB:
@@ -79,12 +79,18 @@ inline void RawPut8(uint64 Field,void *Data)
 #define USE_MEM_BYTESWAP
 #endif
 
+// GCC provides byte swap builtins since 4.3, Clang defines older
+// __GNUC__ version, but supports them too.
+#if defined(__clang__) || __GNUC__ > 4 || __GNUC__ == 4 && __GNUC_MINOR__ > 2
+#define USE_GCC_BYTESWAP
+#endif
+
 // Load 4 big endian bytes from memory and return uint32.
 inline uint32 RawGetBE4(const byte *m)
 {
 #if defined(USE_MEM_BYTESWAP) && defined(_MSC_VER)
   return _byteswap_ulong(*(uint32 *)m);
-#elif defined(USE_MEM_BYTESWAP) && (__GNUC__ > 3) && (__GNUC_MINOR__ > 2)
+#elif defined(USE_MEM_BYTESWAP) && defined(USE_GCC_BYTESWAP)
   return __builtin_bswap32(*(uint32 *)m);
 #else
   return uint32(m[0]<<24) | uint32(m[1]<<16) | uint32(m[2]<<8) | m[3];
@@ -92,12 +98,25 @@ inline uint32 RawGetBE4(const byte *m)
 }
 
 
+// Load 8 big endian bytes from memory and return uint64.
+inline uint64 RawGetBE8(const byte *m)
+{
+#if defined(USE_MEM_BYTESWAP) && defined(_MSC_VER)
+  return _byteswap_uint64(*(uint64 *)m);
+#elif defined(USE_MEM_BYTESWAP) && defined(USE_GCC_BYTESWAP)
+  return __builtin_bswap64(*(uint64 *)m);
+#else
+  return INT32TO64(RawGetBE4(m),RawGetBE4(m+4));
+#endif
+}
+
+
 // Save integer to memory as big endian.
 inline void RawPutBE4(uint32 i,byte *mem)
 {
 #if defined(USE_MEM_BYTESWAP) && defined(_MSC_VER)
   *(uint32*)mem = _byteswap_ulong(i);
-#elif defined(USE_MEM_BYTESWAP) && (__GNUC__ > 3) && (__GNUC_MINOR__ > 2)
+#elif defined(USE_MEM_BYTESWAP) && defined(USE_GCC_BYTESWAP)
   *(uint32*)mem = __builtin_bswap32(i);
 #else
   mem[0]=byte(i>>24);
@@ -112,7 +131,7 @@ inline uint32 ByteSwap32(uint32 i)
 {
 #ifdef _MSC_VER
   return _byteswap_ulong(i);
-#elif (__GNUC__ > 3) && (__GNUC_MINOR__ > 2)
+#elif defined(USE_GCC_BYTESWAP)
   return  __builtin_bswap32(i);
 #else
   return (rotl32(i,24)&0xFF00FF00)|(rotl32(i,8)&0x00FF00FF);
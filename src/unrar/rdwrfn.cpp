@@ -147,6 +147,47 @@ int ComprDataIO::UnpRead(byte *Addr,size_t Count)
 }
 
 
+#ifdef RAR_SMP
+// Read packed data in unpack I/O thread, while the main thread processes
+// the previously read data. Only the source file is accessed here, so it is
+// safe as long as the main thread does not read it until we are done.
+// Count must not exceed the data left in current volume. Read errors are
+// not reported here, -1 tells the caller to repeat reading with UnpRead.
+int ComprDataIO::UnpReadAhead(byte *Addr,size_t Count)
+{
+  if (UnpackFromMemory || !SrcFile->IsOpened())
+    return -1;
+  // Read through Archive::Read, so quick open keeps track of the archive
+  // position. Exceptions are disabled, because we must not throw them
+  // in I/O thread.
+  SrcFile->SetExceptions(false);
+  int ReadSize=SrcFile->Read(Addr,Count);
+  SrcFile->SetExceptions(true);
+  return ReadSize;
+}
+
+
+// Complete reading data returned by UnpReadAhead in the main thread.
+// Update hashes and progress and decrypt data same as UnpRead.
+int ComprDataIO::UnpReadAheadDone(byte *Addr,int ReadSize)
+{
+  Archive *SrcArc=(Archive *)SrcFile;
+  FileHeader *hd=SubHead!=NULL ? SubHead:&SrcArc->FileHead;
+  if (!NoFileHeader && hd->SplitAfter)
+    PackedDataHash.Update(Addr,ReadSize);
+  CurUnpRead+=ReadSize;
+  UnpPackedSize-=ReadSize;
+  ShowUnpRead(SrcArc->CurBlockPos+CurUnpRead,UnpArcSize);
+#ifndef RAR_NOCRYPT
+  if (Decryption)
+    Decrypt->DecryptBlock(Addr,ReadSize);
+#endif
+  Wait();
+  return ReadSize;
+}
+#endif
+
+
 #if defined(RARDLL) && defined(_MSC_VER) && !defined(_WIN_64)
 // Disable the run time stack check for unrar.dll, so we can manipulate
 // with ProcessDataProc call type below. Run time check would intercept
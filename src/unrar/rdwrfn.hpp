@@ -57,10 +57,15 @@ class ComprDataIO
     ~ComprDataIO();
     void Init();
     int UnpRead(byte *Addr,size_t Count);
+#ifdef RAR_SMP
+    int UnpReadAhead(byte *Addr,size_t Count);
+    int UnpReadAheadDone(byte *Addr,int ReadSize);
+#endif
     void UnpWrite(byte *Addr,size_t Count);
     void EnableShowProgress(bool Show) {ShowProgress=Show;}
     void GetUnpackedData(byte **Data,size_t *Size);
     void SetPackedSizeToRead(int64 Size) {UnpPackedSize=Size;}
+    int64 GetPackedSizeToRead() {return UnpPackedSize;} // Left in current volume.
     void SetTestMode(bool Mode) {TestMode=Mode;}
     void SetSkipUnpCRC(bool Skip) {SkipUnpCRC=Skip;}
     void SetNoFileHeader(bool Mode) {NoFileHeader=Mode;}
@@ -19,6 +19,7 @@ class RSEncode // Encode or decode data area, one object per one thread.
     size_t RecBufferSize;
     int *Erasures;
     int EraSize;
+    byte *DecMatrix; // EraSize rows of FileNumber decoding coefficients.
 };
 
 
@@ -164,12 +165,14 @@ bool RecVolumes3::Restore(RAROptions *Cmd,const wchar *Name,bool Silent)
     {
       NewStyle=true;
 
-      wchar *Dot=GetExt(CurName);
+      // Count underscores in file name only, folders may contain them too.
+      wchar *NamePart=PointToName(CurName);
+      wchar *Dot=GetExt(NamePart);
       if (Dot!=NULL)
       {
         int LineCount=0;
         Dot--;
-        while (Dot>CurName && *Dot!='.')
+        while (Dot>NamePart && *Dot!='.')
         {
           if (*Dot=='_')
             LineCount++;
@@ -371,6 +374,13 @@ bool RecVolumes3::Restore(RAROptions *Cmd,const wchar *Name,bool Silent)
   for (uint I=0;I<ThreadNumber;I++)
     rse[I].Init(RecVolNumber);
 
+  // Erasures are the same for all data, so we calculate decoding
+  // coefficients once and share them between threads.
+  Array<byte> DecMatrix(EraSize*TotalFiles);
+  RSCoder RSC;
+  RSC.Init(RecVolNumber);
+  RSC.MakeDecodeMatrix(TotalFiles,Erasures,EraSize,&DecMatrix[0]);
+
   while (true)
   {
     Wait();
@@ -417,6 +427,7 @@ bool RecVolumes3::Restore(RAROptions *Cmd,const wchar *Name,bool Silent)
       curenc->RecBufferSize=RecBufferSize;
       curenc->Erasures=Erasures;
       curenc->EraSize=EraSize;
+      curenc->DecMatrix=&DecMatrix[0];
 
 #ifdef RAR_SMP
       if (ThreadNumber>1)
@@ -482,16 +493,22 @@ bool RecVolumes3::Restore(RAROptions *Cmd,const wchar *Name,bool Silent)
 }
 
 
+// Instead of decoding every byte position separately, we add products
+// of decoding coefficients and whole valid data rows to zero filled erased
+// rows. We process the area in blocks small enough to keep erased rows
+// in CPU cache while adding all valid rows to them.
 void RSEncode::DecodeBuf()
 {
-  for (int BufPos=BufStart;BufPos<BufEnd;BufPos++)
+  const size_t CacheBlockSize=0x10000;
+  for (size_t Pos=BufStart;Pos<(size_t)BufEnd;Pos+=CacheBlockSize)
   {
-    byte Data[256];
-    for (int I=0;I<FileNumber;I++)
-      Data[I]=Buf[I*RecBufferSize+BufPos];
-    RSC.Decode(Data,FileNumber,Erasures,EraSize);
+    size_t Size=Min(CacheBlockSize,BufEnd-Pos);
     for (int I=0;I<EraSize;I++)
-      Buf[Erasures[I]*RecBufferSize+BufPos]=Data[Erasures[I]];
+    {
+      byte *Dest=Buf+Erasures[I]*RecBufferSize+Pos;
+      for (int J=0;J<FileNumber;J++)
+        RSC.MulAdd(DecMatrix[I*FileNumber+J],Buf+J*RecBufferSize+Pos,Dest,Size);
+    }
   }
 }
 
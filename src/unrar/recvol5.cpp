@@ -126,8 +126,17 @@ void RecVolumes5::ProcessRS(RAROptions *Cmd,uint DataNum,const byte *Data,uint M
 void RecVolumes5::ProcessAreaRS(RecRSThreadData *td)
 {
   uint Count=td->Encode ? RecCount : MissingVolumes;
-  for (uint I=0;I<Count;I++)
-    td->RS->UpdateECC(td->DataNum, I, td->Data+td->StartPos, Buf+I*RecBufferSize+td->StartPos, td->Size);
+
+  // Process the area in blocks fitting into CPU cache, so we read data
+  // from memory once for all ECC blocks instead of once per ECC block.
+  const size_t CacheBlockSize=0x10000;
+  for (size_t Pos=0;Pos<td->Size;Pos+=CacheBlockSize)
+  {
+    size_t Size=Min(td->Size-Pos,CacheBlockSize);
+    size_t Offset=td->StartPos+Pos;
+    for (uint I=0;I<Count;I++)
+      td->RS->UpdateECC(td->DataNum, I, td->Data+Offset, Buf+I*RecBufferSize+Offset, Size);
+  }
 }
 
 
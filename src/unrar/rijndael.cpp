@@ -2,7 +2,7 @@
  * This code is based on public domain Szymon Stefanek AES implementation: *
  * http://www.pragmaware.net/software/rijndael/index.php                   *
  *                                                                         *
- * Dynamic tables generation is based on the Brian Gladman work:           *
+ * Tables generation is based on the Brian Gladman work:                   *
  * http://fp.gladman.plus.com/cryptography_technology/rijndael             *
  ***************************************************************************/
 #include "rar.hpp"
@@ -11,10 +11,75 @@
 #include <wmmintrin.h>
 #endif
 
-static byte S[256],S5[256],rcon[30];
-static byte T1[256][4],T2[256][4],T3[256][4],T4[256][4];
-static byte T5[256][4],T6[256][4],T7[256][4],T8[256][4];
-static byte U1[256][4],U2[256][4],U3[256][4],U4[256][4];
+#define ff_poly 0x011b
+#define ff_hi   0x80
+
+#define FFinv(x)    ((x) ? pow[255 - log[x]]: 0)
+
+#define FFmul02(x) (x ? pow[log[x] + 0x19] : 0)
+#define FFmul03(x) (x ? pow[log[x] + 0x01] : 0)
+#define FFmul09(x) (x ? pow[log[x] + 0xc7] : 0)
+#define FFmul0b(x) (x ? pow[log[x] + 0x68] : 0)
+#define FFmul0d(x) (x ? pow[log[x] + 0xee] : 0)
+#define FFmul0e(x) (x ? pow[log[x] + 0xdf] : 0)
+#define fwd_affine(x) \
+    (w = (uint)x, w ^= (w<<1)^(w<<2)^(w<<3)^(w<<4), (byte)(0x63^(w^(w>>8))))
+
+#define inv_affine(x) \
+    (w = (uint)x, w = (w<<1)^(w<<3)^(w<<6), (byte)(0x05^(w^(w>>8))))
+
+// We generate tables in compile time, so they are placed to read-only
+// data section and do not need initialization when loading the library.
+struct RijndaelTables
+{
+  byte S[256],S5[256],rcon[30];
+  byte T1[256][4],T2[256][4],T3[256][4],T4[256][4];
+  byte T5[256][4],T6[256][4],T7[256][4],T8[256][4];
+  byte U1[256][4],U2[256][4],U3[256][4],U4[256][4];
+
+  constexpr RijndaelTables() : S(),S5(),rcon(),T1(),T2(),T3(),T4(),
+                               T5(),T6(),T7(),T8(),U1(),U2(),U3(),U4()
+  {
+    byte pow[512]={},log[256]={};
+    int i = 0, w = 1; 
+    do
+    {   
+      pow[i] = (byte)w;
+      pow[i + 255] = (byte)w;
+      log[w] = (byte)i++;
+      w ^=  (w << 1) ^ (w & ff_hi ? ff_poly : 0);
+    } while (w != 1);
+   
+    w = 1;
+    for (size_t i = 0; i < sizeof(rcon)/sizeof(rcon[0]); i++)
+    {
+      rcon[i] = (byte)w;
+      w = (w << 1) ^ (w & ff_hi ? ff_poly : 0);
+    }
+    for(int i = 0; i < 256; ++i)
+    {   
+      byte b=S[i]=fwd_affine(FFinv((byte)i));
+      T1[i][1]=T1[i][2]=T2[i][2]=T2[i][3]=T3[i][0]=T3[i][3]=T4[i][0]=T4[i][1]=b;
+      T1[i][0]=T2[i][1]=T3[i][2]=T4[i][3]=FFmul02(b);
+      T1[i][3]=T2[i][0]=T3[i][1]=T4[i][2]=FFmul03(b);
+      S5[i] = b = FFinv(inv_affine((byte)i));
+      U1[b][3]=U2[b][0]=U3[b][1]=U4[b][2]=T5[i][3]=T6[i][0]=T7[i][1]=T8[i][2]=FFmul0b(b);
+      U1[b][1]=U2[b][2]=U3[b][3]=U4[b][0]=T5[i][1]=T6[i][2]=T7[i][3]=T8[i][0]=FFmul09(b);
+      U1[b][2]=U2[b][3]=U3[b][0]=U4[b][1]=T5[i][2]=T6[i][3]=T7[i][0]=T8[i][1]=FFmul0d(b);
+      U1[b][0]=U2[b][1]=U3[b][2]=U4[b][3]=T5[i][0]=T6[i][1]=T7[i][2]=T8[i][3]=FFmul0e(b);
+    }
+  }
+};
+
+static constexpr RijndaelTables Tables;
+
+static const byte (&S)[256]=Tables.S, (&S5)[256]=Tables.S5, (&rcon)[30]=Tables.rcon;
+static const byte (&T1)[256][4]=Tables.T1, (&T2)[256][4]=Tables.T2;
+static const byte (&T3)[256][4]=Tables.T3, (&T4)[256][4]=Tables.T4;
+static const byte (&T5)[256][4]=Tables.T5, (&T6)[256][4]=Tables.T6;
+static const byte (&T7)[256][4]=Tables.T7, (&T8)[256][4]=Tables.T8;
+static const byte (&U1)[256][4]=Tables.U1, (&U2)[256][4]=Tables.U2;
+static const byte (&U3)[256][4]=Tables.U3, (&U4)[256][4]=Tables.U4;
 
 
 inline void Xor128(void *dest,const void *arg1,const void *arg2)
@@ -63,8 +128,6 @@ inline void Copy128(byte *dest,const byte *src)
 
 Rijndael::Rijndael()
 {
-  if (S[0]==0)
-    GenerateTables();
   CBCMode = true; // Always true for RAR.
 }
 
@@ -74,9 +137,7 @@ void Rijndael::Init(bool Encrypt,const byte *key,uint keyLen,const byte * initVe
 #ifdef USE_SSE
   // Check SSE here instead of constructor, so if object is a part of some
   // structure memset'ed before use, this variable is not lost.
-  int CPUInfo[4];
-  __cpuid(CPUInfo, 1);
-  AES_NI=(CPUInfo[2] & 0x2000000)!=0;
+  AES_NI=(_CPU_Features & CPUF_AES)!=0;
 #endif
 
   uint uKeyLenInBytes;
@@ -180,6 +241,7 @@ void Rijndael::blockEncrypt(const byte *input,size_t inputLen,byte *outBuffer)
 
 
 #ifdef USE_SSE
+SSE_FUNCTION("aes")
 void Rijndael::blockEncryptSSE(const byte *input,size_t numBlocks,byte *outBuffer)
 {
   __m128i v = _mm_loadu_si128((__m128i*)m_initVector);
@@ -283,6 +345,7 @@ void Rijndael::blockDecrypt(const byte *input, size_t inputLen, byte *outBuffer)
 
 
 #ifdef USE_SSE
+SSE_FUNCTION("aes")
 void Rijndael::blockDecryptSSE(const byte *input, size_t numBlocks, byte *outBuffer)
 {
   __m128i initVector = _mm_loadu_si128((__m128i*)m_initVector);
@@ -407,55 +470,6 @@ void Rijndael::keyEncToDec()
 } 
 
 
-#define ff_poly 0x011b
-#define ff_hi   0x80
-
-#define FFinv(x)    ((x) ? pow[255 - log[x]]: 0)
-
-#define FFmul02(x) (x ? pow[log[x] + 0x19] : 0)
-#define FFmul03(x) (x ? pow[log[x] + 0x01] : 0)
-#define FFmul09(x) (x ? pow[log[x] + 0xc7] : 0)
-#define FFmul0b(x) (x ? pow[log[x] + 0x68] : 0)
-#define FFmul0d(x) (x ? pow[log[x] + 0xee] : 0)
-#define FFmul0e(x) (x ? pow[log[x] + 0xdf] : 0)
-#define fwd_affine(x) \
-    (w = (uint)x, w ^= (w<<1)^(w<<2)^(w<<3)^(w<<4), (byte)(0x63^(w^(w>>8))))
-
-#define inv_affine(x) \
-    (w = (uint)x, w = (w<<1)^(w<<3)^(w<<6), (byte)(0x05^(w^(w>>8))))
-
-void Rijndael::GenerateTables()
-{
-  unsigned char pow[512],log[256];
-  int i = 0, w = 1; 
-  do
-  {   
-    pow[i] = (byte)w;
-    pow[i + 255] = (byte)w;
-    log[w] = (byte)i++;
-    w ^=  (w << 1) ^ (w & ff_hi ? ff_poly : 0);
-  } while (w != 1);
- 
-  for (int i = 0,w = 1; i < sizeof(rcon)/sizeof(rcon[0]); i++)
-  {
-    rcon[i] = w;
-    w = (w << 1) ^ (w & ff_hi ? ff_poly : 0);
-  }
-  for(int i = 0; i < 256; ++i)
-  {   
-    unsigned char b=S[i]=fwd_affine(FFinv((byte)i));
-    T1[i][1]=T1[i][2]=T2[i][2]=T2[i][3]=T3[i][0]=T3[i][3]=T4[i][0]=T4[i][1]=b;
-    T1[i][0]=T2[i][1]=T3[i][2]=T4[i][3]=FFmul02(b);
-    T1[i][3]=T2[i][0]=T3[i][1]=T4[i][2]=FFmul03(b);
-    S5[i] = b = FFinv(inv_affine((byte)i));
-    U1[b][3]=U2[b][0]=U3[b][1]=U4[b][2]=T5[i][3]=T6[i][0]=T7[i][1]=T8[i][2]=FFmul0b(b);
-    U1[b][1]=U2[b][2]=U3[b][3]=U4[b][0]=T5[i][1]=T6[i][2]=T7[i][3]=T8[i][0]=FFmul09(b);
-    U1[b][2]=U2[b][3]=U3[b][0]=U4[b][1]=T5[i][2]=T6[i][3]=T7[i][0]=T8[i][1]=FFmul0d(b);
-    U1[b][0]=U2[b][1]=U3[b][2]=U4[b][3]=T5[i][0]=T6[i][1]=T7[i][2]=T8[i][3]=FFmul0e(b);
-  }
-}
-
-
 #if 0
 static void TestRijndael();
 struct TestRij {TestRij() {TestRijndael();exit(0);}} GlobalTestRij;
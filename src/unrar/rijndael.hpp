@@ -5,7 +5,7 @@
  * This code is based on Szymon Stefanek AES implementation:              *
  * http://www.esat.kuleuven.ac.be/~rijmen/rijndael/rijndael-cpplib.tar.gz *
  *                                                                        *
- * Dynamic tables generation is based on the Brian Gladman's work:        *
+ * Tables generation is based on the Brian Gladman's work:                *
  * http://fp.gladman.plus.com/cryptography_technology/rijndael            *
  **************************************************************************/
 
@@ -24,7 +24,6 @@ class Rijndael
 #endif
     void keySched(byte key[_MAX_KEY_COLUMNS][4]);
     void keyEncToDec();
-    void GenerateTables();
 
     // RAR always uses CBC, but we may need to turn it off when calling
     // this code from other archive formats with CTR and other modes.
@@ -158,3 +158,150 @@ bool RSCoder::Decode(byte *Data,int DataSize,int *EraLoc,int EraSize)
     }
   return(ErrCount<=ParSize); // Return true if success.
 }
+
+
+// Erasure locations are the same for all data positions, so Decode is
+// a linear function of valid bytes and every restored byte is a sum of
+// products of valid bytes and constant coefficients. We find coefficients
+// by decoding unit vectors. Matrix receives EraSize rows of DataSize
+// coefficients, coefficients of erased positions are zero.
+void RSCoder::MakeDecodeMatrix(int DataSize,int *EraLoc,int EraSize,byte *Matrix)
+{
+  memset(Matrix,0,EraSize*DataSize);
+  FirstBlockDone=false;
+  for (int J=0;J<DataSize;J++)
+  {
+    bool Erased=false;
+    for (int I=0;I<EraSize;I++)
+      if (EraLoc[I]==J)
+        Erased=true;
+    if (Erased)
+      continue;
+    byte Data[MAXPAR+1];
+    memset(Data,0,DataSize);
+    Data[J]=1;
+    Decode(Data,DataSize,EraLoc,EraSize);
+    for (int I=0;I<EraSize;I++)
+      Matrix[I*DataSize+J]=Data[EraLoc[I]];
+  }
+}
+
+
+// Add the product of M and Src to Dest.
+void RSCoder::MulAdd(uint M,const byte *Src,byte *Dest,size_t Size)
+{
+  if (M==0)
+    return;
+#ifdef USE_SSE
+  if (_SSE_Version>=SSE_AVX2)
+  {
+    AVX2_MulAdd(M,Src,Dest,Size);
+    return;
+  }
+  if (_SSE_Version>=SSE_SSSE3)
+  {
+    SSE_MulAdd(M,Src,Dest,Size);
+    return;
+  }
+#elif defined(USE_NEON)
+  NEON_MulAdd(M,Src,Dest,Size);
+  return;
+#endif
+
+  byte T[256];
+  for (uint I=0;I<256;I++)
+    T[I]=gfMult(I,M);
+  for (size_t I=0;I<Size;I++)
+    Dest[I]^=T[Src[I]];
+}
+
+
+#ifdef USE_SSE
+// Multiplication is distributive over addition, so product of M and byte
+// is a sum of M products of its low and high 4 bits. 16 item tables
+// of such products fit into SSE registers and we can look up 16 bytes
+// at once with PSHUFB.
+SSE_FUNCTION("ssse3")
+void RSCoder::SSE_MulAdd(uint M,const byte *Src,byte *Dest,size_t Size)
+{
+  byte TL[16],TH[16];
+  for (uint I=0;I<16;I++)
+  {
+    TL[I]=gfMult(I,M);
+    TH[I]=gfMult(I<<4,M);
+  }
+  __m128i T0=_mm_loadu_si128((__m128i *)TL);
+  __m128i T1=_mm_loadu_si128((__m128i *)TH);
+  __m128i Low4Mask=_mm_set1_epi8(0xf);
+
+  size_t Pos=0;
+  for (;Pos+sizeof(__m128i)<=Size;Pos+=sizeof(__m128i))
+  {
+    __m128i D=_mm_loadu_si128((__m128i *)(Src+Pos));
+    __m128i L=_mm_and_si128(D,Low4Mask);
+    __m128i H=_mm_and_si128(_mm_srli_epi16(D,4),Low4Mask);
+    __m128i P=_mm_xor_si128(_mm_shuffle_epi8(T0,L),_mm_shuffle_epi8(T1,H));
+    __m128i *StoreDest=(__m128i *)(Dest+Pos);
+    _mm_storeu_si128(StoreDest,_mm_xor_si128(_mm_loadu_si128(StoreDest),P));
+  }
+  for (;Pos<Size;Pos++)
+    Dest[Pos]^=gfMult(Src[Pos],M);
+}
+
+
+// Same as SSE_MulAdd, but 256 bit registers hold two copies of tables,
+// because VPSHUFB looks up in each 128 bit lane separately.
+SSE_FUNCTION("avx2")
+void RSCoder::AVX2_MulAdd(uint M,const byte *Src,byte *Dest,size_t Size)
+{
+  byte TL[16],TH[16];
+  for (uint I=0;I<16;I++)
+  {
+    TL[I]=gfMult(I,M);
+    TH[I]=gfMult(I<<4,M);
+  }
+  __m256i T0=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)TL));
+  __m256i T1=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)TH));
+  __m256i Low4Mask=_mm256_set1_epi8(0xf);
+
+  size_t Pos=0;
+  for (;Pos+sizeof(__m256i)<=Size;Pos+=sizeof(__m256i))
+  {
+    __m256i D=_mm256_loadu_si256((__m256i *)(Src+Pos));
+    __m256i L=_mm256_and_si256(D,Low4Mask);
+    __m256i H=_mm256_and_si256(_mm256_srli_epi16(D,4),Low4Mask);
+    __m256i P=_mm256_xor_si256(_mm256_shuffle_epi8(T0,L),_mm256_shuffle_epi8(T1,H));
+    __m256i *StoreDest=(__m256i *)(Dest+Pos);
+    _mm256_storeu_si256(StoreDest,_mm256_xor_si256(_mm256_loadu_si256(StoreDest),P));
+  }
+  for (;Pos<Size;Pos++)
+    Dest[Pos]^=gfMult(Src[Pos],M);
+}
+#endif
+
+
+#ifdef USE_NEON
+// Split table multiplication with TBL instruction.
+void RSCoder::NEON_MulAdd(uint M,const byte *Src,byte *Dest,size_t Size)
+{
+  byte TL[16],TH[16];
+  for (uint I=0;I<16;I++)
+  {
+    TL[I]=gfMult(I,M);
+    TH[I]=gfMult(I<<4,M);
+  }
+  uint8x16_t T0=vld1q_u8(TL),T1=vld1q_u8(TH);
+  uint8x16_t Low4Mask=vdupq_n_u8(0xf);
+
+  size_t Pos=0;
+  for (;Pos+16<=Size;Pos+=16)
+  {
+    uint8x16_t D=vld1q_u8(Src+Pos);
+    uint8x16_t P=veorq_u8(vqtbl1q_u8(T0,vandq_u8(D,Low4Mask)),
+                          vqtbl1q_u8(T1,vshrq_n_u8(D,4)));
+    vst1q_u8(Dest+Pos,veorq_u8(vld1q_u8(Dest+Pos),P));
+  }
+  for (;Pos<Size;Pos++)
+    Dest[Pos]^=gfMult(Src[Pos],M);
+}
+#endif
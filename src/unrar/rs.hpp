@@ -12,6 +12,14 @@ class RSCoder
     void pnInit();
     void pnMult(int *p1,int *p2,int *r);
 
+#ifdef USE_SSE
+    void SSE_MulAdd(uint M,const byte *Src,byte *Dest,size_t Size);
+    void AVX2_MulAdd(uint M,const byte *Src,byte *Dest,size_t Size);
+#endif
+#ifdef USE_NEON
+    void NEON_MulAdd(uint M,const byte *Src,byte *Dest,size_t Size);
+#endif
+
     int gfExp[MAXPOL];   // Galois field exponents.
     int gfLog[MAXPAR+1]; // Galois field logarithms.
 
@@ -27,6 +35,8 @@ class RSCoder
     void Init(int ParSize);
     void Encode(byte *Data,int DataSize,byte *DestData);
     bool Decode(byte *Data,int DataSize,int *EraLoc,int EraSize);
+    void MakeDecodeMatrix(int DataSize,int *EraLoc,int EraSize,byte *Matrix);
+    void MulAdd(uint M,const byte *Src,byte *Dest,size_t Size);
 };
 
 #endif
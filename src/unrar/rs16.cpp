@@ -12,8 +12,6 @@ RSCoder16::RSCoder16()
   ND=NR=NE=0;
   ValidFlags=NULL;
   MX=NULL;
-  DataLog=NULL;
-  DataLogSize=0;
 
   gfInit();
 }
@@ -23,7 +21,6 @@ RSCoder16::~RSCoder16()
 {
   delete[] gfExp;
   delete[] gfLog;
-  delete[] DataLog;
   delete[] MX;
   delete[] ValidFlags;
 }
@@ -272,48 +269,45 @@ void RSCoder16::UpdateECC(uint DataNum, uint ECCNum, const byte *Data, byte *ECC
 #endif
 
 #ifdef USE_SSE
+  if (DirectAccess && _SSE_Version>=SSE_AVX2)
+  {
+    AVX2_UpdateECC(DataNum,ECCNum,Data,ECC,BlockSize);
+    return;
+  }
   if (DirectAccess && SSE_UpdateECC(DataNum,ECCNum,Data,ECC,BlockSize))
     return;
+#elif defined(USE_NEON)
+  if (DirectAccess)
+  {
+    NEON_UpdateECC(DataNum,ECCNum,Data,ECC,BlockSize);
+    return;
+  }
 #endif
 
-  if (ECCNum==0)
+  // Multiplication is distributive over addition, so product of M and
+  // 16 bit number is a sum of M products of its low and high bytes.
+  // Two 256 item tables are small enough to stay in L1 cache, unlike
+  // 16 bit logarithm and exponent tables.
+  uint M=MX[ECCNum * ND + DataNum];
+  ushort TL[256],TH[256];
+  for (uint I=0;I<256;I++)
   {
-    if (DataLogSize!=BlockSize)
-    {
-      delete[] DataLog;
-      DataLog=new uint[BlockSize];
-      DataLogSize=BlockSize;
-
-    }
-    if (DirectAccess)
-      for (size_t I=0; I<BlockSize; I+=2)
-        DataLog[I] = gfLog[ *(ushort*)(Data+I) ];
-    else
-      for (size_t I=0; I<BlockSize; I+=2)
-      {
-        uint D=Data[I]+Data[I+1]*256;
-        DataLog[I] = gfLog[ D ];
-      }
+    TL[I]=gfMul(I,M);
+    TH[I]=gfMul(I<<8,M);
   }
 
-  uint ML = gfLog[ MX[ECCNum * ND + DataNum] ];
-
-  if (DirectAccess)
-    for (size_t I=0; I<BlockSize; I+=2)
-      *(ushort*)(ECC+I) ^= gfExp[ ML + DataLog[I] ];
-  else
-    for (size_t I=0; I<BlockSize; I+=2)
-    {
-      uint R=gfExp[ ML + DataLog[I] ];
-      ECC[I]^=byte(R);
-      ECC[I+1]^=byte(R/256);
-    }
+  for (size_t I=0; I<BlockSize; I+=2)
+  {
+    uint R=TL[Data[I]]^TH[Data[I+1]];
+    ECC[I]^=byte(R);
+    ECC[I+1]^=byte(R/256);
+  }
 }
 
 
 #ifdef USE_SSE
 // Data and ECC addresses must be properly aligned for SSE.
-// AVX2 did not provide a noticeable speed gain on i7-6700K here.
+SSE_FUNCTION("ssse3")
 bool RSCoder16::SSE_UpdateECC(uint DataNum, uint ECCNum, const byte *Data, byte *ECC, size_t BlockSize)
 {
   // Check data alignment and SSSE3 support.
@@ -416,4 +410,117 @@ bool RSCoder16::SSE_UpdateECC(uint DataNum, uint ECCNum, const byte *Data, byte
   
   return true;
 }
+
+
+// Same split table multiplication as in SSE_UpdateECC, but 256 bit
+// registers hold two copies of 128 bit tables, because VPSHUFB looks up
+// in each 128 bit lane separately. Packing and unpacking instructions are
+// also lane local, so they restore the original word order without
+// additional permutations. Unaligned access is as fast as aligned here.
+SSE_FUNCTION("avx2")
+void RSCoder16::AVX2_UpdateECC(uint DataNum, uint ECCNum, const byte *Data, byte *ECC, size_t BlockSize)
+{
+  uint M=MX[ECCNum * ND + DataNum];
+
+  byte TL[4][16],TH[4][16]; // Low and high bytes of products.
+  for (uint I=0;I<16;I++)
+    for (uint T=0;T<4;T++)
+    {
+      uint P=gfMul(I<<(T*4),M);
+      TL[T][I]=byte(P);
+      TH[T][I]=byte(P>>8);
+    }
+
+  __m256i T0L=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)TL[0]));
+  __m256i T1L=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)TL[1]));
+  __m256i T2L=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)TL[2]));
+  __m256i T3L=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)TL[3]));
+  __m256i T0H=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)TH[0]));
+  __m256i T1H=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)TH[1]));
+  __m256i T2H=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)TH[2]));
+  __m256i T3H=_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)TH[3]));
+
+  __m256i LowByteMask=_mm256_set1_epi16(0xff);
+  __m256i Low4Mask=_mm256_set1_epi8(0xf);
+
+  size_t Pos=0;
+  for (; Pos+2*sizeof(__m256i)<=BlockSize; Pos+=2*sizeof(__m256i))
+  {
+    __m256i D0=_mm256_loadu_si256((__m256i *)(Data+Pos));
+    __m256i D1=_mm256_loadu_si256((__m256i *)(Data+Pos+sizeof(__m256i)));
+
+    __m256i LowBytes=_mm256_packus_epi16(_mm256_and_si256(D0,LowByteMask),
+                                         _mm256_and_si256(D1,LowByteMask));
+    __m256i HighBytes=_mm256_packus_epi16(_mm256_srli_epi16(D0,8),
+                                          _mm256_srli_epi16(D1,8));
+
+    __m256i LL=_mm256_and_si256(LowBytes,Low4Mask);
+    __m256i LH=_mm256_and_si256(_mm256_srli_epi16(LowBytes,4),Low4Mask);
+    __m256i HL=_mm256_and_si256(HighBytes,Low4Mask);
+    __m256i HH=_mm256_and_si256(_mm256_srli_epi16(HighBytes,4),Low4Mask);
+
+    __m256i SumL=_mm256_xor_si256(
+      _mm256_xor_si256(_mm256_shuffle_epi8(T0L,LL),_mm256_shuffle_epi8(T1L,LH)),
+      _mm256_xor_si256(_mm256_shuffle_epi8(T2L,HL),_mm256_shuffle_epi8(T3L,HH)));
+    __m256i SumH=_mm256_xor_si256(
+      _mm256_xor_si256(_mm256_shuffle_epi8(T0H,LL),_mm256_shuffle_epi8(T1H,LH)),
+      _mm256_xor_si256(_mm256_shuffle_epi8(T2H,HL),_mm256_shuffle_epi8(T3H,HH)));
+
+    __m256i *StoreECC=(__m256i *)(ECC+Pos);
+    _mm256_storeu_si256(StoreECC,_mm256_xor_si256(_mm256_loadu_si256(StoreECC),
+                        _mm256_unpacklo_epi8(SumL,SumH)));
+    _mm256_storeu_si256(StoreECC+1,_mm256_xor_si256(_mm256_loadu_si256(StoreECC+1),
+                        _mm256_unpackhi_epi8(SumL,SumH)));
+  }
+
+  for (; Pos<BlockSize; Pos+=2)
+    *(ushort*)(ECC+Pos) ^= gfMul( M, *(ushort*)(Data+Pos) );
+}
+#endif
+
+
+#ifdef USE_NEON
+// Split table multiplication with TBL instruction. Interleaved load
+// separates low and high bytes of 16 bit words without additional packing.
+void RSCoder16::NEON_UpdateECC(uint DataNum, uint ECCNum, const byte *Data, byte *ECC, size_t BlockSize)
+{
+  uint M=MX[ECCNum * ND + DataNum];
+
+  byte TL[4][16],TH[4][16]; // Low and high bytes of products.
+  for (uint I=0;I<16;I++)
+    for (uint T=0;T<4;T++)
+    {
+      uint P=gfMul(I<<(T*4),M);
+      TL[T][I]=byte(P);
+      TH[T][I]=byte(P>>8);
+    }
+
+  uint8x16_t T0L=vld1q_u8(TL[0]),T1L=vld1q_u8(TL[1]),T2L=vld1q_u8(TL[2]),T3L=vld1q_u8(TL[3]);
+  uint8x16_t T0H=vld1q_u8(TH[0]),T1H=vld1q_u8(TH[1]),T2H=vld1q_u8(TH[2]),T3H=vld1q_u8(TH[3]);
+  uint8x16_t Low4Mask=vdupq_n_u8(0xf);
+
+  size_t Pos=0;
+  for (; Pos+32<=BlockSize; Pos+=32)
+  {
+    uint8x16x2_t D=vld2q_u8(Data+Pos); // val[0] low bytes, val[1] high bytes.
+
+    uint8x16_t LL=vandq_u8(D.val[0],Low4Mask);
+    uint8x16_t LH=vshrq_n_u8(D.val[0],4);
+    uint8x16_t HL=vandq_u8(D.val[1],Low4Mask);
+    uint8x16_t HH=vshrq_n_u8(D.val[1],4);
+
+    uint8x16_t SumL=veorq_u8(veorq_u8(vqtbl1q_u8(T0L,LL),vqtbl1q_u8(T1L,LH)),
+                             veorq_u8(vqtbl1q_u8(T2L,HL),vqtbl1q_u8(T3L,HH)));
+    uint8x16_t SumH=veorq_u8(veorq_u8(vqtbl1q_u8(T0H,LL),vqtbl1q_u8(T1H,LH)),
+                             veorq_u8(vqtbl1q_u8(T2H,HL),vqtbl1q_u8(T3H,HH)));
+
+    uint8x16x2_t E=vld2q_u8(ECC+Pos);
+    E.val[0]=veorq_u8(E.val[0],SumL);
+    E.val[1]=veorq_u8(E.val[1],SumH);
+    vst2q_u8(ECC+Pos,E);
+  }
+
+  for (; Pos<BlockSize; Pos+=2)
+    *(ushort*)(ECC+Pos) ^= gfMul( M, *(ushort*)(Data+Pos) );
+}
 #endif
@@ -18,6 +18,10 @@ class RSCoder16
 
 #ifdef USE_SSE
     bool SSE_UpdateECC(uint DataNum, uint ECCNum, const byte *Data, byte *ECC, size_t BlockSize);
+    void AVX2_UpdateECC(uint DataNum, uint ECCNum, const byte *Data, byte *ECC, size_t BlockSize);
+#endif
+#ifdef USE_NEON
+    void NEON_UpdateECC(uint DataNum, uint ECCNum, const byte *Data, byte *ECC, size_t BlockSize);
 #endif
 
     bool Decoding;    // If we are decoding or encoding data.
@@ -27,9 +31,6 @@ class RSCoder16
     bool *ValidFlags; // Validity flags for data and ECC units.
     uint *MX;         // Cauchy based coding or decoding matrix.
 
-    uint *DataLog; // Buffer to store data logarithms for UpdateECC.
-    size_t DataLogSize;
-
   public:
     RSCoder16();
     ~RSCoder16();
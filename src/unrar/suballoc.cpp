@@ -71,7 +71,7 @@ void SubAllocator::StopSubAllocator()
   if ( SubAllocatorSize ) 
   {
     SubAllocatorSize=0;
-    free(HeapStart);
+    MemPoolFree(HeapStart,AllocSize);
   }
 }
 
@@ -87,12 +87,18 @@ bool SubAllocator::StartSubAllocator(int SASize)
   // can be larger. So let's recalculate the allocated size and add two more
   // units: one as reserve for HeapEnd overflow checks and another
   // to provide the space to correctly align UnitsStart.
-  uint AllocSize=t/FIXED_UNIT_SIZE*UNIT_SIZE+2*UNIT_SIZE;
-  if ((HeapStart=(byte *)malloc(AllocSize)) == NULL)
+  AllocSize=t/FIXED_UNIT_SIZE*UNIT_SIZE+2*UNIT_SIZE;
+
+  // Model heap can be as large as sliding dictionary, so we reuse it
+  // when extracting many PPMd archives. We do not need to clear it,
+  // because InitSubAllocator resets all allocator structures and model
+  // never reads the heap memory before writing it.
+  if ((HeapStart=(byte *)MemPoolAlloc(AllocSize)) == NULL)
   {
     ErrHandler.MemoryError();
     return false;
   }
+  MemPoolAdvise(HeapStart,AllocSize);
 
   // HeapEnd did not present in original algorithm. We added it to control
   // invalid memory access attempts when processing corrupt archived data.
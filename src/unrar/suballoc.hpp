@@ -62,6 +62,7 @@ class SubAllocator
     inline RARPPM_MEM_BLK* MBPtr(RARPPM_MEM_BLK *BasePtr,int Items);
 
     long SubAllocatorSize;
+    uint AllocSize;
     byte Indx2Units[N_INDEXES], Units2Indx[128], GlueCount;
     byte *HeapStart,*LoUnit, *HiUnit;
     struct RAR_NODE FreeList[N_INDEXES];
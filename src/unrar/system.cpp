@@ -1,5 +1,9 @@
 #include "rar.hpp"
 
+#if defined(USE_SSE) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
 static int SleepTime=0;
 
 void InitSystemOptions(int SleepTime)
@@ -161,14 +165,64 @@ bool IsUserAdmin()
 
 #ifdef USE_SSE
 SSE_VERSION _SSE_Version=GetSSEVersion();
+uint _CPU_Features=GetCPUFeatures();
+
+
+static void GetCPUID(int *CPUInfo,int Function)
+{
+#ifdef _MSC_VER
+  __cpuidex(CPUInfo,Function,0);
+#else
+  __cpuid_count(Function,0,CPUInfo[0],CPUInfo[1],CPUInfo[2],CPUInfo[3]);
+#endif
+}
+
+
+// Return the extended processor states enabled by operating system.
+// AVX instructions can be used only if operating system preserves
+// YMM registers when switching threads.
+static uint64 GetEnabledXState()
+{
+  int CPUInfo[4];
+  GetCPUID(CPUInfo, 1);
+  const int OSXSAVE_AVX=0x18000000;
+  if ((CPUInfo[2] & OSXSAVE_AVX)!=OSXSAVE_AVX)
+    return 0;
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  uint XCR0Low,XCR0High;
+  __asm__ ("xgetbv" : "=a"(XCR0Low),"=d"(XCR0High) : "c"(0));
+  return XCR0Low;
+#endif
+}
+
+
+static bool IsAVXEnabled()
+{
+  return (GetEnabledXState() & 6)==6; // XMM and YMM states are enabled.
+}
+
+
+static bool IsAVX512Enabled()
+{
+  // XMM, YMM, opmask and both halves of ZMM states are enabled.
+  return (GetEnabledXState() & 0xe6)==0xe6;
+}
+
 
 SSE_VERSION GetSSEVersion()
 {
   int CPUInfo[4];
-  __cpuid(CPUInfo, 7);
-  if ((CPUInfo[1] & 0x20)!=0)
-    return SSE_AVX2;
-  __cpuid(CPUInfo, 1);
+  GetCPUID(CPUInfo, 0);
+  int MaxFunction=CPUInfo[0];
+  if (MaxFunction>=7)
+  {
+    GetCPUID(CPUInfo, 7);
+    if ((CPUInfo[1] & 0x20)!=0 && IsAVXEnabled())
+      return SSE_AVX2;
+  }
+  GetCPUID(CPUInfo, 1);
   if ((CPUInfo[2] & 0x80000)!=0)
     return SSE_SSE41;
   if ((CPUInfo[2] & 0x200)!=0)
@@ -179,4 +233,28 @@ SSE_VERSION GetSSEVersion()
     return SSE_SSE;
   return SSE_NONE;
 }
+
+
+uint GetCPUFeatures()
+{
+  uint Features=0;
+  int CPUInfo[4];
+  GetCPUID(CPUInfo, 0);
+  int MaxFunction=CPUInfo[0];
+  GetCPUID(CPUInfo, 1);
+  if ((CPUInfo[2] & 0x2000000)!=0)
+    Features|=CPUF_AES;
+  if ((CPUInfo[2] & 0x2)!=0)
+    Features|=CPUF_PCLMUL;
+  if (MaxFunction>=7)
+  {
+    GetCPUID(CPUInfo, 7);
+    if ((CPUInfo[2] & 0x400)!=0 && IsAVXEnabled())
+      Features|=CPUF_VPCLMUL;
+    const uint AVX512F_VL=0x80010000; // AVX512F and AVX512VL.
+    if (((uint)CPUInfo[1] & AVX512F_VL)==AVX512F_VL && IsAVX512Enabled())
+      Features|=CPUF_AVX512;
+  }
+  return Features;
+}
 #endif
@@ -34,6 +34,11 @@ bool IsUserAdmin();
 enum SSE_VERSION {SSE_NONE,SSE_SSE,SSE_SSE2,SSE_SSSE3,SSE_SSE41,SSE_AVX2};
 SSE_VERSION GetSSEVersion();
 extern SSE_VERSION _SSE_Version;
+
+// Instruction set extensions, which are not implied by SSE_VERSION.
+enum {CPUF_AES=1,CPUF_PCLMUL=2,CPUF_VPCLMUL=4,CPUF_AVX512=8};
+uint GetCPUFeatures();
+extern uint _CPU_Features;
 #endif
 
 #endif
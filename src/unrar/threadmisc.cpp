@@ -1,7 +1,3 @@
-// Typically we use the same global thread pool for all RAR modules.
-static ThreadPool *GlobalPool=NULL;
-static uint GlobalPoolUseCount=0;
-
 static inline bool CriticalSectionCreate(CRITSECT_HANDLE *CritSection)
 {
 #ifdef _WIN_ALL
@@ -43,57 +39,6 @@ static inline void CriticalSectionEnd(CRITSECT_HANDLE *CritSection)
 }
 
 
-static struct GlobalPoolCreateSync
-{
-  CRITSECT_HANDLE CritSection;
-  GlobalPoolCreateSync()  { CriticalSectionCreate(&CritSection); }
-  ~GlobalPoolCreateSync() { CriticalSectionDelete(&CritSection); }
-} PoolCreateSync;
-
-
-ThreadPool* CreateThreadPool()
-{
-  CriticalSectionStart(&PoolCreateSync.CritSection); 
-
-  if (GlobalPoolUseCount++ == 0)
-    GlobalPool=new ThreadPool(MaxPoolThreads);
-
-  // We use a simple thread pool, which does not allow to add tasks from
-  // different functions and threads in the same time. It is ok for RAR,
-  // but UnRAR.dll can be used in multithreaded environment. So if one of
-  // threads requests a copy of global pool and another copy is already
-  // in use, we create and return a new pool instead of existing global.
-  if (GlobalPoolUseCount > 1)
-  {
-    ThreadPool *Pool = new ThreadPool(MaxPoolThreads);
-    CriticalSectionEnd(&PoolCreateSync.CritSection); 
-    return Pool;
-  }
-
-  CriticalSectionEnd(&PoolCreateSync.CritSection); 
-  return GlobalPool;
-}
-
-
-void DestroyThreadPool(ThreadPool *Pool)
-{
-  if (Pool!=NULL)
-  {
-    CriticalSectionStart(&PoolCreateSync.CritSection); 
-
-    if (Pool==GlobalPool && GlobalPoolUseCount > 0 && --GlobalPoolUseCount == 0)
-      delete GlobalPool;
-
-    // To correctly work in multithreaded environment UnRAR.dll creates
-    // new pools if global pool is already in use. We delete such pools here.
-    if (Pool!=GlobalPool)
-      delete Pool;
-
-    CriticalSectionEnd(&PoolCreateSync.CritSection); 
-  }
-}
-
-
 static THREAD_HANDLE ThreadCreate(NATIVE_THREAD_PTR Proc,void *Data)
 {
 #ifdef _UNIX
@@ -163,6 +108,60 @@ static void cpthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
 #endif
 
 
+static inline bool CondVarCreate(COND_HANDLE *Cond)
+{
+#ifdef _WIN_ALL
+  InitializeConditionVariable(Cond);
+  return true;
+#elif defined(_UNIX)
+  return pthread_cond_init(Cond,NULL)==0;
+#endif
+}
+
+
+static inline void CondVarDelete(COND_HANDLE *Cond)
+{
+#ifdef _UNIX
+  pthread_cond_destroy(Cond);
+#endif
+}
+
+
+// Wait for condition. Critical section must be entered by caller.
+static inline void CondVarWait(COND_HANDLE *Cond,CRITSECT_HANDLE *CritSection)
+{
+#ifdef _WIN_ALL
+  if (!SleepConditionVariableCS(Cond,CritSection,INFINITE))
+  {
+    ErrHandler.GeneralErrMsg(L"\nSleepConditionVariableCS error %d",GetLastError());
+    ErrHandler.Exit(RARX_FATAL);
+  }
+#elif defined(_UNIX)
+  cpthread_cond_wait(Cond,CritSection);
+#endif
+}
+
+
+static inline void CondVarSignal(COND_HANDLE *Cond)
+{
+#ifdef _WIN_ALL
+  WakeConditionVariable(Cond);
+#elif defined(_UNIX)
+  pthread_cond_signal(Cond);
+#endif
+}
+
+
+static inline void CondVarBroadcast(COND_HANDLE *Cond)
+{
+#ifdef _WIN_ALL
+  WakeAllConditionVariable(Cond);
+#elif defined(_UNIX)
+  pthread_cond_broadcast(Cond);
+#endif
+}
+
+
 uint GetNumberOfCPU()
 {
 #ifndef RAR_SMP
@@ -7,64 +7,120 @@
 int ThreadPool::ThreadPriority=THREAD_PRIORITY_NORMAL;
 #endif
 
-ThreadPool::ThreadPool(uint MaxThreads)
-{
-  MaxAllowedThreads = MaxThreads;
-  if (MaxAllowedThreads>MaxPoolThreads)
-    MaxAllowedThreads=MaxPoolThreads;
-  if (MaxAllowedThreads==0)
-    MaxAllowedThreads=1;
 
-  ThreadsCreatedCount=0;
+// Process-wide work-stealing task scheduler shared by all thread pools.
+// Every worker has its own task queue. New tasks are distributed among
+// queues in round robin order. Worker takes the most recent task from
+// its own queue and if it is empty, steals the oldest task from queues
+// of other workers. Threads waiting for their pools also process queued
+// tasks of these pools instead of sleeping.
+class TaskScheduler
+{
+  private:
+    struct QueueEntry
+    {
+      PTHREAD_PROC Proc;
+      void *Param;
+      ThreadPool *Pool;
+    };
 
-  // If we have more threads than queue size, we'll hang on pool destroying,
-  // not releasing all waiting threads.
-  if (MaxAllowedThreads>ASIZE(TaskQueue))
-    MaxAllowedThreads=ASIZE(TaskQueue);
+    // Number of entries in every worker queue. If all queues are full,
+    // we run the task in the calling thread.
+    static const uint MaxQueuedTasks=64;
 
+    struct WorkerQueue
+    {
+      CRITSECT_HANDLE CritSection;
+      QueueEntry Tasks[MaxQueuedTasks];
+      uint Top;    // Owner worker adds and takes tasks here.
+      uint Bottom; // Other workers steal tasks here.
+    };
+
+    static NATIVE_THREAD_TYPE WorkerThread(void *Param);
+    static void ExecutorThread(void *Param);
+    void WorkerLoop(uint Index,bool Persistent);
+    void StartWorkers();
+    bool GetTask(uint Index,QueueEntry *Task);
+    bool GetPoolTask(ThreadPool *Pool,QueueEntry *Task);
+    void RunTask(QueueEntry *Task);
+
+    WorkerQueue Queues[MaxPoolThreads];
+    uint WorkerCount;
+    uint NextQueue; // Queue for next task in round robin order.
+
+    bool WorkersStarted;
+    THREAD_HANDLE ThreadHandles[MaxPoolThreads];
+    uint ThreadsCreatedCount;
+    uint ThreadsStartedCount;
+
+    THREAD_EXECUTOR Executor;
+    void *ExecutorContext;
+    uint ExecutorWorkers; // Number of workers running in external executor.
+    uint64 ExecutorQueues; // Bit mask of queues used by executor workers.
+
+    // Number of tasks in all queues. Can be negative for a short time,
+    // because worker can take a task before it is counted here.
+    int QueuedTasks;
+
+    bool Closing; // Set true to quit all threads.
+
+    // Protects scheduler variables excluding task queues
+    // and PendingTasks of all thread pools.
+    CRITSECT_HANDLE CritSection;
+
+    COND_HANDLE TaskAdded;   // Signalled when new task is queued.
+    COND_HANDLE TaskDone;    // Signalled when pool tasks are completed.
+  public:
+    TaskScheduler(uint Threads,THREAD_EXECUTOR Executor,void *ExecutorContext);
+    ~TaskScheduler();
+    void AddTask(ThreadPool *Pool,PTHREAD_PROC Proc,void *Data);
+    void WaitDone(ThreadPool *Pool);
+};
+
+
+TaskScheduler::TaskScheduler(uint Threads,THREAD_EXECUTOR Executor,void *ExecutorContext)
+{
+  WorkerCount=Threads;
+  if (WorkerCount>MaxPoolThreads)
+    WorkerCount=MaxPoolThreads;
+  if (WorkerCount==0)
+    WorkerCount=1;
+
+  TaskScheduler::Executor=Executor;
+  TaskScheduler::ExecutorContext=ExecutorContext;
+  NextQueue=0;
+  WorkersStarted=false;
+  ThreadsCreatedCount=0;
+  ThreadsStartedCount=0;
+  ExecutorWorkers=0;
+  ExecutorQueues=0;
+  QueuedTasks=0;
   Closing=false;
 
-  bool Success = CriticalSectionCreate(&CritSection);
-#ifdef _WIN_ALL
-  QueuedTasksCnt=CreateSemaphore(NULL,0,ASIZE(TaskQueue),NULL);
-  NoneActive=CreateEvent(NULL,TRUE,TRUE,NULL);
-  Success=Success && QueuedTasksCnt!=NULL && NoneActive!=NULL;
-#elif defined(_UNIX)
-  AnyActive = false;
-  QueuedTasksCnt = 0;
-  Success=Success && pthread_cond_init(&AnyActiveCond,NULL)==0 &&
-          pthread_mutex_init(&AnyActiveMutex,NULL)==0 &&
-          pthread_cond_init(&QueuedTasksCntCond,NULL)==0 &&
-          pthread_mutex_init(&QueuedTasksCntMutex,NULL)==0;
-#endif
+  bool Success=CriticalSectionCreate(&CritSection) &&
+               CondVarCreate(&TaskAdded) && CondVarCreate(&TaskDone);
+  for (uint I=0;I<WorkerCount;I++)
+  {
+    Success=Success && CriticalSectionCreate(&Queues[I].CritSection);
+    Queues[I].Top=Queues[I].Bottom=0;
+  }
   if (!Success)
   {
     ErrHandler.GeneralErrMsg(L"\nThread pool initialization failed.");
     ErrHandler.Exit(RARX_FATAL);
   }
-
-  QueueTop = 0;
-  QueueBottom = 0;
-  ActiveThreads = 0;
 }
 
 
-ThreadPool::~ThreadPool()
+TaskScheduler::~TaskScheduler()
 {
-  WaitDone();
+  CriticalSectionStart(&CritSection);
   Closing=true;
-
-#ifdef _WIN_ALL
-  ReleaseSemaphore(QueuedTasksCnt,ASIZE(TaskQueue),NULL);
-#elif defined(_UNIX)
-  // Threads still can access QueuedTasksCnt for a short time after WaitDone(),
-  // so lock is required. We would occassionally hang without it.
-  pthread_mutex_lock(&QueuedTasksCntMutex);
-  QueuedTasksCnt+=ASIZE(TaskQueue);
-  pthread_mutex_unlock(&QueuedTasksCntMutex);
-
-  pthread_cond_broadcast(&QueuedTasksCntCond);
-#endif
+  CondVarBroadcast(&TaskAdded);
+  // Executor workers quit when queues are empty, just wait for them.
+  while (ExecutorWorkers>0)
+    CondVarWait(&TaskDone,&CritSection);
+  CriticalSectionEnd(&CritSection);
 
   for(uint I=0;I<ThreadsCreatedCount;I++)
   {
@@ -77,24 +133,23 @@ ThreadPool::~ThreadPool()
     ThreadClose(ThreadHandles[I]);
   }
 
+  for (uint I=0;I<WorkerCount;I++)
+    CriticalSectionDelete(&Queues[I].CritSection);
+  CondVarDelete(&TaskAdded);
+  CondVarDelete(&TaskDone);
   CriticalSectionDelete(&CritSection);
-#ifdef _WIN_ALL
-  CloseHandle(QueuedTasksCnt);
-  CloseHandle(NoneActive);
-#elif defined(_UNIX)
-  pthread_cond_destroy(&AnyActiveCond);
-  pthread_mutex_destroy(&AnyActiveMutex);
-  pthread_cond_destroy(&QueuedTasksCntCond);
-  pthread_mutex_destroy(&QueuedTasksCntMutex);
-#endif
 }
 
 
-void ThreadPool::CreateThreads()
+// Must be called inside of scheduler critical section.
+void TaskScheduler::StartWorkers()
 {
-  for(uint I=0;I<MaxAllowedThreads;I++)
+  WorkersStarted=true;
+  if (Executor!=NULL) // Executor workers are started when adding tasks.
+    return;
+  for(uint I=0;I<WorkerCount;I++)
   {
-    ThreadHandles[I] = ThreadCreate(PoolThread, this);
+    ThreadHandles[I] = ThreadCreate(WorkerThread, this);
     ThreadsCreatedCount++;
 #ifdef _WIN_ALL
     if (ThreadPool::ThreadPriority!=THREAD_PRIORITY_NORMAL)
@@ -104,111 +159,443 @@ void ThreadPool::CreateThreads()
 }
 
 
-NATIVE_THREAD_TYPE ThreadPool::PoolThread(void *Param)
+NATIVE_THREAD_TYPE TaskScheduler::WorkerThread(void *Param)
 {
-  ((ThreadPool*)Param)->PoolThreadLoop();
+  TaskScheduler *Sch=(TaskScheduler*)Param;
+  CriticalSectionStart(&Sch->CritSection);
+  uint Index=Sch->ThreadsStartedCount++;
+  CriticalSectionEnd(&Sch->CritSection);
+
+  Sch->WorkerLoop(Index,true);
   return 0;
 }
 
 
-void ThreadPool::PoolThreadLoop()
+void TaskScheduler::ExecutorThread(void *Param)
+{
+  TaskScheduler *Sch=(TaskScheduler*)Param;
+
+  // Use the first queue not owned by other executor worker.
+  CriticalSectionStart(&Sch->CritSection);
+  uint Index=0;
+  while (Index<Sch->WorkerCount-1 && (Sch->ExecutorQueues & ((uint64)1<<Index))!=0)
+    Index++;
+  Sch->ExecutorQueues|=(uint64)1<<Index;
+  CriticalSectionEnd(&Sch->CritSection);
+
+  Sch->WorkerLoop(Index,false);
+}
+
+
+// Process tasks until closing. Not persistent workers running
+// in external executor return as soon as there are no queued tasks,
+// so they do not occupy threads of external pool.
+void TaskScheduler::WorkerLoop(uint Index,bool Persistent)
+{
+  while (true)
+  {
+    QueueEntry Task;
+    if (GetTask(Index,&Task))
+    {
+      RunTask(&Task);
+      continue;
+    }
+
+    CriticalSectionStart(&CritSection);
+    while (Persistent && QueuedTasks<=0 && !Closing)
+      CondVarWait(&TaskAdded,&CritSection);
+    bool Quit=Persistent ? Closing : QueuedTasks<=0;
+    if (Quit && !Persistent)
+    {
+      ExecutorQueues&=~((uint64)1<<Index);
+      if (--ExecutorWorkers==0)
+        CondVarBroadcast(&TaskDone);
+    }
+    CriticalSectionEnd(&CritSection);
+
+    if (Quit)
+      break;
+  }
+}
+
+
+// Take the most recent task from worker own queue, so it is more likely
+// to have its data in CPU cache, or steal the oldest task from other
+// queues.
+bool TaskScheduler::GetTask(uint Index,QueueEntry *Task)
+{
+  bool Found=false;
+  if (Index<WorkerCount)
+  {
+    WorkerQueue *Q=Queues+Index;
+    CriticalSectionStart(&Q->CritSection);
+    if (Q->Top!=Q->Bottom)
+    {
+      Q->Top=(Q->Top+MaxQueuedTasks-1) % MaxQueuedTasks;
+      *Task=Q->Tasks[Q->Top];
+      Found=true;
+    }
+    CriticalSectionEnd(&Q->CritSection);
+  }
+  for (uint I=1;I<=WorkerCount && !Found;I++)
+  {
+    WorkerQueue *Q=Queues+(Index+I) % WorkerCount;
+    CriticalSectionStart(&Q->CritSection);
+    if (Q->Top!=Q->Bottom)
+    {
+      *Task=Q->Tasks[Q->Bottom];
+      Q->Bottom=(Q->Bottom+1) % MaxQueuedTasks;
+      Found=true;
+    }
+    CriticalSectionEnd(&Q->CritSection);
+  }
+  if (Found)
+  {
+    CriticalSectionStart(&CritSection);
+    QueuedTasks--;
+    Task->Pool->QueuedTasks--;
+    CriticalSectionEnd(&CritSection);
+  }
+  return Found;
+}
+
+
+// Take the oldest queued task of specified pool. Used by threads waiting
+// for this pool, so they do not start unrelated and possibly long tasks
+// and return to caller as soon as their own tasks are completed.
+bool TaskScheduler::GetPoolTask(ThreadPool *Pool,QueueEntry *Task)
+{
+  bool Found=false;
+  for (uint I=0;I<WorkerCount && !Found;I++)
+  {
+    WorkerQueue *Q=Queues+I;
+    CriticalSectionStart(&Q->CritSection);
+    for (uint Pos=Q->Bottom;Pos!=Q->Top && !Found;Pos=(Pos+1) % MaxQueuedTasks)
+      if (Q->Tasks[Pos].Pool==Pool)
+      {
+        *Task=Q->Tasks[Pos];
+        // Shift older tasks to fill the gap, preserving their order.
+        for (uint J=Pos;J!=Q->Bottom;J=(J+MaxQueuedTasks-1) % MaxQueuedTasks)
+          Q->Tasks[J]=Q->Tasks[(J+MaxQueuedTasks-1) % MaxQueuedTasks];
+        Q->Bottom=(Q->Bottom+1) % MaxQueuedTasks;
+        Found=true;
+      }
+    CriticalSectionEnd(&Q->CritSection);
+  }
+  if (Found)
+  {
+    CriticalSectionStart(&CritSection);
+    QueuedTasks--;
+    Pool->QueuedTasks--;
+    CriticalSectionEnd(&CritSection);
+  }
+  return Found;
+}
+
+
+void TaskScheduler::RunTask(QueueEntry *Task)
+{
+  Task->Proc(Task->Param);
+
+  CriticalSectionStart(&CritSection);
+  if (--Task->Pool->PendingTasks==0)
+    CondVarBroadcast(&TaskDone);
+  CriticalSectionEnd(&CritSection);
+}
+
+
+void TaskScheduler::AddTask(ThreadPool *Pool,PTHREAD_PROC Proc,void *Data)
 {
   QueueEntry Task;
-  while (GetQueuedTask(&Task))
+  Task.Proc=Proc;
+  Task.Param=Data;
+  Task.Pool=Pool;
+
+  CriticalSectionStart(&CritSection);
+  if (!WorkersStarted)
+    StartWorkers();
+  Pool->PendingTasks++;
+  uint First=NextQueue;
+  NextQueue=(NextQueue+1) % WorkerCount;
+  CriticalSectionEnd(&CritSection);
+
+  bool Queued=false;
+  for (uint I=0;I<WorkerCount && !Queued;I++)
   {
-    Task.Proc(Task.Param);
-    
-    CriticalSectionStart(&CritSection); 
-    if (--ActiveThreads == 0)
+    WorkerQueue *Q=Queues+(First+I) % WorkerCount;
+    CriticalSectionStart(&Q->CritSection);
+    uint NewTop=(Q->Top+1) % MaxQueuedTasks;
+    if (NewTop!=Q->Bottom)
     {
-#ifdef _WIN_ALL
-      SetEvent(NoneActive);
-#elif defined(_UNIX)
-      pthread_mutex_lock(&AnyActiveMutex);
-      AnyActive=false;
-      pthread_cond_signal(&AnyActiveCond);
-      pthread_mutex_unlock(&AnyActiveMutex);
-#endif
+      Q->Tasks[Q->Top]=Task;
+      Q->Top=NewTop;
+      Queued=true;
+    }
+    CriticalSectionEnd(&Q->CritSection);
+  }
+  if (!Queued) // All queues are full.
+  {
+    RunTask(&Task);
+    return;
+  }
+
+  bool StartExecutor=false;
+  CriticalSectionStart(&CritSection);
+  QueuedTasks++;
+  Pool->QueuedTasks++;
+  if (Executor!=NULL && ExecutorWorkers<WorkerCount)
+  {
+    ExecutorWorkers++;
+    StartExecutor=true;
+  }
+  CondVarSignal(&TaskAdded);
+  if (Pool->Waiters>0) // Let threads waiting for this pool process the task.
+    CondVarBroadcast(&TaskDone);
+  CriticalSectionEnd(&CritSection);
+
+  // Executor can refuse to start a worker if all its threads are busy,
+  // possibly including the thread adding this task. Then we do not count
+  // the worker, so we do not wait for it when closing. Queued task is
+  // processed by other workers or by thread waiting for its pool.
+  if (StartExecutor && !Executor(ExecutorThread,this,ExecutorContext))
+  {
+    CriticalSectionStart(&CritSection);
+    if (--ExecutorWorkers==0)
+      CondVarBroadcast(&TaskDone);
+    CriticalSectionEnd(&CritSection);
+  }
+}
+
+
+// Wait until all tasks of specified pool are completed.
+void TaskScheduler::WaitDone(ThreadPool *Pool)
+{
+  CriticalSectionStart(&CritSection);
+  Pool->Waiters++;
+  while (Pool->PendingTasks!=0)
+  {
+    if (Pool->QueuedTasks<=0)
+    {
+      // Nothing is queued, so remaining pool tasks are running now.
+      // We are woken up when they complete or new pool task is queued.
+      CondVarWait(&TaskDone,&CritSection);
+      continue;
     }
-    CriticalSectionEnd(&CritSection); 
+    CriticalSectionEnd(&CritSection);
+
+    // Process queued pool tasks instead of sleeping. Also it prevents
+    // a deadlock if external executor has no free threads to run workers.
+    QueueEntry Task;
+    if (GetPoolTask(Pool,&Task))
+      RunTask(&Task);
+
+    CriticalSectionStart(&CritSection);
   }
+  Pool->Waiters--;
+  CriticalSectionEnd(&CritSection);
 }
 
 
-bool ThreadPool::GetQueuedTask(QueueEntry *Task)
+IOThread::IOThread()
 {
+  Started=false;
+  Closing=false;
+  Busy=false;
+  if (!CriticalSectionCreate(&CritSection) ||
+      !CondVarCreate(&TaskAdded) || !CondVarCreate(&TaskDone))
+  {
+    ErrHandler.GeneralErrMsg(L"\nThread pool initialization failed.");
+    ErrHandler.Exit(RARX_FATAL);
+  }
+}
+
+
+IOThread::~IOThread()
+{
+  if (Started)
+  {
+    CriticalSectionStart(&CritSection);
+    Closing=true;
+    CondVarSignal(&TaskAdded);
+    CriticalSectionEnd(&CritSection);
 #ifdef _WIN_ALL
-  CWaitForSingleObject(QueuedTasksCnt);
-#elif defined(_UNIX)
-  pthread_mutex_lock(&QueuedTasksCntMutex);
-  while (QueuedTasksCnt==0)
-    cpthread_cond_wait(&QueuedTasksCntCond,&QueuedTasksCntMutex);
-  QueuedTasksCnt--;
-  pthread_mutex_unlock(&QueuedTasksCntMutex);
+    CWaitForSingleObject(Thread);
 #endif
+    ThreadClose(Thread);
+  }
+  CondVarDelete(&TaskAdded);
+  CondVarDelete(&TaskDone);
+  CriticalSectionDelete(&CritSection);
+}
 
-  if (Closing)
-    return false;
 
-  CriticalSectionStart(&CritSection); 
+NATIVE_THREAD_TYPE IOThread::Run(void *Param)
+{
+  IOThread *IO=(IOThread *)Param;
+  CriticalSectionStart(&IO->CritSection);
+  while (true)
+  {
+    while (!IO->Busy && !IO->Closing)
+      CondVarWait(&IO->TaskAdded,&IO->CritSection);
+    if (!IO->Busy) // Closing and nothing to do.
+      break;
+    CriticalSectionEnd(&IO->CritSection);
 
-  *Task = TaskQueue[QueueBottom];
-  QueueBottom = (QueueBottom + 1) % ASIZE(TaskQueue);
+    IO->Proc(IO->Data);
+
+    CriticalSectionStart(&IO->CritSection);
+    IO->Busy=false;
+    CondVarSignal(&IO->TaskDone);
+  }
+  CriticalSectionEnd(&IO->CritSection);
+  return 0;
+}
 
-  CriticalSectionEnd(&CritSection); 
 
-  return true;
+// Previous task must be completed before adding a new one.
+void IOThread::AddTask(PTHREAD_PROC Proc,void *Data)
+{
+  if (!Started)
+  {
+    Thread=ThreadCreate(Run,this);
+    Started=true;
+  }
+  CriticalSectionStart(&CritSection);
+  IOThread::Proc=Proc;
+  IOThread::Data=Data;
+  Busy=true;
+  CondVarSignal(&TaskAdded);
+  CriticalSectionEnd(&CritSection);
 }
 
 
-// Add task to queue. We assume that it is always called from main thread,
-// it allows to avoid any locks here. We process collected tasks only
-// when WaitDone is called.
-void ThreadPool::AddTask(PTHREAD_PROC Proc,void *Data)
+void IOThread::WaitDone()
+{
+  CriticalSectionStart(&CritSection);
+  while (Busy)
+    CondVarWait(&TaskDone,&CritSection);
+  CriticalSectionEnd(&CritSection);
+}
+
+
+// Typically we use the same global scheduler for all RAR modules.
+// It is kept when the last pool is destroyed, so we do not restart worker
+// threads for every processed file. It is recreated only if its settings
+// are changed while no pools are in use.
+static TaskScheduler *GlobalScheduler=NULL;
+static uint GlobalSchedulerUseCount=0;
+static uint GlobalSchedulerThreads=0; // Number of workers of existing scheduler.
+static uint SchedulerThreads=0;
+static THREAD_EXECUTOR SchedulerExecutor=NULL;
+static void *SchedulerExecutorContext=NULL;
+
+
+static struct GlobalPoolCreateSync
 {
-  if (ThreadsCreatedCount == 0)
-    CreateThreads();
-  
-  // If queue is full, wait until it is empty.
-  if ((QueueTop + 1) % ASIZE(TaskQueue) == QueueBottom)
-    WaitDone();
+  CRITSECT_HANDLE CritSection;
+  GlobalPoolCreateSync()  { CriticalSectionCreate(&CritSection); }
+  ~GlobalPoolCreateSync() { CriticalSectionDelete(&CritSection); }
+} PoolCreateSync;
 
-  TaskQueue[QueueTop].Proc = Proc;
-  TaskQueue[QueueTop].Param = Data;
-  QueueTop = (QueueTop + 1) % ASIZE(TaskQueue);
+
+ThreadPool::ThreadPool()
+{
+  PendingTasks=0;
+  QueuedTasks=0;
+  Waiters=0;
 }
 
 
-// Start queued tasks and wait until all threads are inactive.
-// We assume that it is always called from main thread, when pool threads
-// are sleeping yet.
+ThreadPool::~ThreadPool()
+{
+  WaitDone();
+}
+
+
+// Add task to scheduler. Unlike the original RAR pool, tasks can be added
+// from different threads and start immediately, not when WaitDone is called.
+void ThreadPool::AddTask(PTHREAD_PROC Proc,void *Data)
+{
+  GlobalScheduler->AddTask(this,Proc,Data);
+}
+
+
+// Wait until all tasks added to this pool are completed.
 void ThreadPool::WaitDone()
 {
-  // We add ASIZE(TaskQueue) for case if TaskQueue array size is not
-  // a power of two. Negative numbers would not suit our purpose here.
-  ActiveThreads=(QueueTop+ASIZE(TaskQueue)-QueueBottom) % ASIZE(TaskQueue);
-  if (ActiveThreads==0)
-    return;
-#ifdef _WIN_ALL
-  ResetEvent(NoneActive);
-  ReleaseSemaphore(QueuedTasksCnt,ActiveThreads,NULL);
-  CWaitForSingleObject(NoneActive);
-#elif defined(_UNIX)
-  AnyActive=true;
-
-  // Threads reset AnyActive before accessing QueuedTasksCnt and even
-  // preceding WaitDone() call does not guarantee that some slow thread
-  // is not accessing QueuedTasksCnt now. So lock is necessary.
-  pthread_mutex_lock(&QueuedTasksCntMutex);
-  QueuedTasksCnt+=ActiveThreads;
-  pthread_mutex_unlock(&QueuedTasksCntMutex);
-
-  pthread_cond_broadcast(&QueuedTasksCntCond);
-
-  pthread_mutex_lock(&AnyActiveMutex);
-  while (AnyActive)
-    cpthread_cond_wait(&AnyActiveCond,&AnyActiveMutex);
-  pthread_mutex_unlock(&AnyActiveMutex);
-#endif
+  GlobalScheduler->WaitDone(this);
+}
+
+
+// Every module creates its own pool to wait for its own tasks only,
+// but all pools share worker threads of the global scheduler.
+ThreadPool* CreateThreadPool()
+{
+  CriticalSectionStart(&PoolCreateSync.CritSection);
+  if (GlobalSchedulerUseCount++ == 0)
+  {
+    uint Threads=SchedulerThreads==0 ? GetNumberOfThreads() : SchedulerThreads;
+    if (GlobalScheduler!=NULL && GlobalSchedulerThreads!=Threads)
+    {
+      delete GlobalScheduler;
+      GlobalScheduler=NULL;
+    }
+    if (GlobalScheduler==NULL)
+    {
+      GlobalScheduler=new TaskScheduler(Threads,SchedulerExecutor,SchedulerExecutorContext);
+      GlobalSchedulerThreads=Threads;
+    }
+  }
+  CriticalSectionEnd(&PoolCreateSync.CritSection);
+  return new ThreadPool;
+}
+
+
+void DestroyThreadPool(ThreadPool *Pool)
+{
+  if (Pool!=NULL)
+  {
+    delete Pool;
+
+    CriticalSectionStart(&PoolCreateSync.CritSection);
+    if (GlobalSchedulerUseCount > 0)
+      GlobalSchedulerUseCount--;
+    CriticalSectionEnd(&PoolCreateSync.CritSection);
+  }
+}
+
+
+void SetThreadPoolSize(uint Threads)
+{
+  CriticalSectionStart(&PoolCreateSync.CritSection);
+  SchedulerThreads=Min(Threads,MaxPoolThreads);
+  CriticalSectionEnd(&PoolCreateSync.CritSection);
+}
+
+
+uint GetThreadPoolSize()
+{
+  CriticalSectionStart(&PoolCreateSync.CritSection);
+  uint Threads=SchedulerThreads;
+  CriticalSectionEnd(&PoolCreateSync.CritSection);
+  return Threads==0 ? GetNumberOfThreads() : Threads;
+}
+
+
+bool SetThreadPoolExecutor(THREAD_EXECUTOR Executor,void *Context)
+{
+  CriticalSectionStart(&PoolCreateSync.CritSection);
+  bool Success=GlobalSchedulerUseCount==0;
+  if (Success && (Executor!=SchedulerExecutor || Context!=SchedulerExecutorContext))
+  {
+    // Idle scheduler can refer to previous executor, which can be deleted
+    // by caller after this call. So destroy it now, waiting for its workers.
+    delete GlobalScheduler;
+    GlobalScheduler=NULL;
+    SchedulerExecutor=Executor;
+    SchedulerExecutorContext=Context;
+  }
+  CriticalSectionEnd(&PoolCreateSync.CritSection);
+  return Success;
 }
 #endif // RAR_SMP
@@ -4,7 +4,7 @@
 #ifndef RAR_SMP
 const uint MaxPoolThreads=1; // For single threaded version.
 #else
-const uint MaxPoolThreads=32;
+const uint MaxPoolThreads=64;
 
 
 #ifdef _UNIX
@@ -20,74 +20,48 @@ const uint MaxPoolThreads=32;
   typedef void* (*NATIVE_THREAD_PTR)(void *Data);
   typedef pthread_t THREAD_HANDLE;
   typedef pthread_mutex_t CRITSECT_HANDLE;
+  typedef pthread_cond_t COND_HANDLE;
 #else
   #define NATIVE_THREAD_TYPE DWORD WINAPI
   typedef DWORD (WINAPI *NATIVE_THREAD_PTR)(void *Data);
   typedef HANDLE THREAD_HANDLE;
   typedef CRITICAL_SECTION CRITSECT_HANDLE;
+  typedef CONDITION_VARIABLE COND_HANDLE;
 #endif
 
 typedef void (*PTHREAD_PROC)(void *Data);
 #define THREAD_PROC(fn) void fn(void *Data)
 
+// External executor, which must call Proc(Data) asynchronously in some
+// thread and return true. It allows to run pool workers in threads of
+// application thread pool instead of creating our own threads. If executor
+// has no free thread, it must return false instead of queuing Proc.
+// We do not wait for such worker and our tasks are processed by threads
+// waiting for their completion. Context is set in SetThreadPoolExecutor.
+typedef bool (*THREAD_EXECUTOR)(PTHREAD_PROC Proc,void *Data,void *Context);
+
 uint GetNumberOfCPU();
 uint GetNumberOfThreads();
 
 
+// Group of tasks executed by process-wide task scheduler. All objects
+// share the same worker threads, so the number of running threads does not
+// depend on number of simultaneously processed archives.
 class ThreadPool
 {
   private:
-    struct QueueEntry
-    {
-    	PTHREAD_PROC Proc;
-      void *Param;
-    };
-
-    void CreateThreads();
-    static NATIVE_THREAD_TYPE PoolThread(void *Param);
-  	void PoolThreadLoop();
-  	bool GetQueuedTask(QueueEntry *Task);
-
-    // Number of threads in the pool. Must not exceed MaxPoolThreads.
-    uint MaxAllowedThreads;
-  	THREAD_HANDLE ThreadHandles[MaxPoolThreads];
-
-    // Number of actually created threads.
-    uint ThreadsCreatedCount;
-
-    uint ActiveThreads;
+    friend class TaskScheduler;
 
-  	QueueEntry TaskQueue[MaxPoolThreads];
-  	uint QueueTop;
-  	uint QueueBottom;
+    // Number of added and not completed tasks. Protected by scheduler lock.
+    uint PendingTasks;
 
-    bool Closing; // Set true to quit all threads.
-  	
-#ifdef _WIN_ALL
-  	// Semaphore counting number of tasks stored in queue.
-  	HANDLE QueuedTasksCnt;
-
-    // Event signalling if no active tasks are performing now.
-    HANDLE NoneActive;
-
-#elif defined(_UNIX)
-    // Semaphores seem to be slower than conditional variables in pthreads,
-    // so we use the conditional variable to count tasks stored in queue.
-    uint QueuedTasksCnt;
-    pthread_cond_t QueuedTasksCntCond;
-    pthread_mutex_t QueuedTasksCntMutex;
-
-    bool AnyActive; // Active tasks present flag.
-    pthread_cond_t AnyActiveCond;
-    pthread_mutex_t AnyActiveMutex;
-#endif
-
-    // Pool critical section. We use the single section for all branches
-    // to avoid deadlocks, when thread1 has section1 and wants section2
-    // and thread2 has section2 and wants section1.
-  	CRITSECT_HANDLE CritSection;
+    // Number of tasks in scheduler queues and threads waiting for this pool.
+    // Protected by scheduler lock. Waiting threads process queued tasks
+    // of their own pool only.
+    int QueuedTasks;
+    uint Waiters;
   public:
-    ThreadPool(uint MaxThreads);
+    ThreadPool();
     ~ThreadPool();
     void AddTask(PTHREAD_PROC Proc,void *Data);
     void WaitDone();
@@ -98,9 +72,45 @@ class ThreadPool
 #endif
 };
 
+// Own thread running one task at a time. Used for blocking I/O, which
+// must not wait in scheduler queues behind CPU intensive tasks and must not
+// be run by threads waiting for their pools. Thread is created with
+// the first task.
+class IOThread
+{
+  private:
+    static NATIVE_THREAD_TYPE Run(void *Param);
+
+    THREAD_HANDLE Thread;
+    bool Started;
+    bool Closing;
+    bool Busy;
+    PTHREAD_PROC Proc;
+    void *Data;
+
+    CRITSECT_HANDLE CritSection;
+    COND_HANDLE TaskAdded;
+    COND_HANDLE TaskDone;
+  public:
+    IOThread();
+    ~IOThread();
+    void AddTask(PTHREAD_PROC Proc,void *Data);
+    void WaitDone();
+};
+
 ThreadPool* CreateThreadPool();
 void DestroyThreadPool(ThreadPool *Pool);
 
+// Set the number of worker threads. 0 means the number of CPU cores.
+// Changes take effect next time a thread pool is created, when no thread
+// pools are in use.
+void SetThreadPoolSize(uint Threads);
+uint GetThreadPoolSize();
+
+// Run pool workers with external executor. NULL means own threads.
+// Executor cannot be changed while thread pools exist, return false then.
+bool SetThreadPoolExecutor(THREAD_EXECUTOR Executor,void *Context);
+
 #endif // RAR_SMP
 
 #endif // _RAR_THREADPOOL_
@@ -15,19 +15,173 @@
 #include "unpack50.cpp"
 #include "unpack50frag.cpp"
 
+#ifdef USE_MAPPED_WINDOW
+// Reserve WinSize bytes of address space without committing memory.
+// Pages are allocated and zero filled by the system on first access,
+// so the physical memory usage is proportional to amount of decoded data.
+static byte* AllocMappedWindow(size_t WinSize)
+{
+  void *Mem=mmap(NULL,WinSize,PROT_READ|PROT_WRITE,
+                 MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE,-1,0);
+  return Mem==MAP_FAILED ? NULL:(byte *)Mem;
+}
+#endif
+
+
+#ifdef USE_MIRROR_WINDOW
+// Allocate WinSize bytes and map them once again immediately after first
+// mapping. Return NULL if mirrored mapping is not available, so caller can
+// fall back to usual allocation.
+static byte* AllocMirrorWindow(size_t WinSize)
+{
+  // Mapping granularity is a page, so we do not mirror tiny windows.
+  if (WinSize<0x100000 || (WinSize & (sysconf(_SC_PAGESIZE)-1))!=0)
+    return NULL;
+  int fd=(int)syscall(SYS_memfd_create,"unrar",0);
+  if (fd<0)
+    return NULL;
+  byte *Mem=NULL;
+  if (ftruncate(fd,WinSize)==0)
+  {
+    void *Area=mmap(NULL,2*WinSize,PROT_NONE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+    if (Area!=MAP_FAILED)
+    {
+      Mem=(byte *)Area;
+      if (mmap(Mem,WinSize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_FIXED,fd,0)==MAP_FAILED ||
+          mmap(Mem+WinSize,WinSize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_FIXED,fd,0)==MAP_FAILED)
+      {
+        munmap(Area,2*WinSize);
+        Mem=NULL;
+      }
+    }
+  }
+  close(fd); // Mappings keep the memory object alive.
+  return Mem;
+}
+#endif
+
+
+#ifdef USE_MAPPED_WINDOW
+static void FreeMappedWindow(void *Mem,size_t WinSize)
+{
+  munmap(Mem,WinSize);
+}
+#endif
+
+
+#ifdef USE_MIRROR_WINDOW
+static void FreeMirrorWindow(void *Mem,size_t WinSize)
+{
+  munmap(Mem,2*WinSize);
+}
+#endif
+
+
+#ifdef RAR_TEST_HOOKS
+// Window type set by SetUnpackWindowType.
+static bool ForceWinType=false;
+static UNPACK_WINDOW_TYPE ForcedWinType=UNPWIN_GENERIC;
+
+
+void SetUnpackWindowType(UNPACK_WINDOW_TYPE Type)
+{
+  ForceWinType=true;
+  ForcedWinType=Type;
+}
+
+
+void ResetUnpackWindowType()
+{
+  ForceWinType=false;
+  ForcedWinType=UNPWIN_GENERIC;
+}
+#endif
+
+
+// Allocate the window memory, trying the most efficient allocation type first.
+// Memory of WINMEM_MAPPED and WINMEM_MIRROR type is already zero filled.
+static byte* AllocWindow(size_t WinSize,WINDOW_MEM_TYPE &MemType)
+{
+  byte *Mem=NULL;
+#ifdef USE_MIRROR_WINDOW
+  bool UseMirror=true;
+#ifdef RAR_TEST_HOOKS
+  UseMirror=!ForceWinType || ForcedWinType!=UNPWIN_NORMAL;
+#endif
+  if (UseMirror && ((Mem=(byte *)MemPoolGet(WinSize,FreeMirrorWindow))!=NULL ||
+      (Mem=AllocMirrorWindow(WinSize))!=NULL))
+  {
+    MemPoolAdvise(Mem,2*WinSize);
+    MemType=WINMEM_MIRROR;
+    return Mem;
+  }
+#endif
+#ifdef USE_MAPPED_WINDOW
+  // Small windows are allocated in heap, where it is more efficient.
+  if (WinSize>=0x1000000 && ((Mem=(byte *)MemPoolGet(WinSize,FreeMappedWindow))!=NULL ||
+      (Mem=AllocMappedWindow(WinSize))!=NULL))
+  {
+    MemPoolAdvise(Mem,WinSize);
+    MemType=WINMEM_MAPPED;
+    return Mem;
+  }
+#endif
+  MemType=WINMEM_HEAP;
+  return (byte *)MemPoolAlloc(WinSize);
+}
+
+
+// Return the window memory to process-wide pool. Mapped windows are cached
+// with their pages discarded, so they do not hold physical memory while
+// cached and are zero filled again when reused.
+static void FreeWindow(byte *Window,size_t WinSize,WINDOW_MEM_TYPE MemType)
+{
+  switch(MemType)
+  {
+#ifdef USE_MAPPED_WINDOW
+    case WINMEM_MAPPED:
+      if (madvise(Window,WinSize,MADV_DONTNEED)==0)
+        MemPoolPut(Window,WinSize,FreeMappedWindow);
+      else
+        FreeMappedWindow(Window,WinSize);
+      break;
+#endif
+#ifdef USE_MIRROR_WINDOW
+    case WINMEM_MIRROR:
+      // MADV_REMOVE releases pages of memory object shared by both mappings.
+      if (madvise(Window,WinSize,MADV_REMOVE)==0)
+        MemPoolPut(Window,WinSize,FreeMirrorWindow);
+      else
+        FreeMirrorWindow(Window,WinSize);
+      break;
+#endif
+    default:
+      MemPoolFree(Window,WinSize);
+      break;
+  }
+}
+
+
 Unpack::Unpack(ComprDataIO *DataIO)
 :Inp(true),VMCodeInp(true)
 {
   UnpIO=DataIO;
   Window=NULL;
   Fragmented=false;
+  WinMemType=WINMEM_HEAP;
+  Mirrored=false;
   Suspended=false;
   UnpAllBuf=false;
   UnpSomeRead=false;
 #ifdef RAR_SMP
   MaxUserThreads=1;
   UnpThreadPool=CreateThreadPool();
-  ReadBufMT=NULL;
+  ReadBufMT=ReadBufMTMem=NULL;
+  ReadBufMTSize=0;
+  ReadAheadThread=new IOThread;
+  ReadAheadBuf=NULL;
+  ReadAheadBufSize=0;
+  ReadAheadActive=false;
   UnpThreadData=NULL;
 #endif
   MaxWinSize=0;
@@ -50,10 +204,12 @@ Unpack::~Unpack()
   InitFilters30(false);
 
   if (Window!=NULL)
-    free(Window);
+    FreeWindow(Window,MaxWinSize,WinMemType);
 #ifdef RAR_SMP
+  delete ReadAheadThread;
   DestroyThreadPool(UnpThreadPool);
-  delete[] ReadBufMT;
+  MemPoolFree(ReadBufMTMem,ReadBufMTSize+UNP_READ_GAP_MT+UNP_READ_OVERFLOW_MT);
+  MemPoolFree(ReadAheadBuf,ReadAheadBufSize+UNP_READ_GAP_MT+UNP_READ_OVERFLOW_MT);
   delete[] UnpThreadData;
 #endif
 }
@@ -91,7 +247,18 @@ void Unpack::Init(size_t WinSize,bool Solid)
   if (Grow && Fragmented)
     throw std::bad_alloc();
 
-  byte *NewWindow=Fragmented ? NULL : (byte *)malloc(WinSize);
+  bool ForceFragmented=false;
+#ifdef RAR_TEST_HOOKS
+  ForceFragmented=ForceWinType && ForcedWinType==UNPWIN_FRAGMENTED &&
+                  !Grow && WinSize>=0x1000000;
+
+  // Forced fragmented window is split to 4 MB blocks to access data
+  // across block boundaries.
+  FragWindow.SetMaxBlockSize(ForceFragmented ? 0x400000:0);
+#endif
+
+  WINDOW_MEM_TYPE NewMemType=WINMEM_HEAP;
+  byte *NewWindow=Fragmented || ForceFragmented ? NULL : AllocWindow(WinSize,NewMemType);
 
   if (NewWindow==NULL)
     if (Grow || WinSize<0x1000000)
@@ -104,8 +271,10 @@ void Unpack::Init(size_t WinSize,bool Solid)
     {
       if (Window!=NULL) // If allocated by preceding files.
       {
-        free(Window);
+        FreeWindow(Window,MaxWinSize,WinMemType);
         Window=NULL;
+        WinMemType=WINMEM_HEAP;
+        Mirrored=false;
       }
       FragWindow.Init(WinSize);
       Fragmented=true;
@@ -115,7 +284,10 @@ void Unpack::Init(size_t WinSize,bool Solid)
   {
     // Clean the window to generate the same output when unpacking corrupt
     // RAR files, which may access unused areas of sliding dictionary.
-    memset(NewWindow,0,WinSize);
+    // Mapped memory is zero filled already, so we do not touch it here
+    // and do not commit physical pages for unused part of window.
+    if (NewMemType==WINMEM_HEAP)
+      memset(NewWindow,0,WinSize);
 
     // If Window is not NULL, it means that window size has grown.
     // In solid streams we need to copy data to a new window in such case.
@@ -126,8 +298,10 @@ void Unpack::Init(size_t WinSize,bool Solid)
         NewWindow[(UnpPtr-I)&(WinSize-1)]=Window[(UnpPtr-I)&(MaxWinSize-1)];
 
     if (Window!=NULL)
-      free(Window);
+      FreeWindow(Window,MaxWinSize,WinMemType);
     Window=NewWindow;
+    WinMemType=NewMemType;
+    Mirrored=NewMemType==WINMEM_MIRROR;
   }
 
   MaxWinSize=WinSize;
@@ -173,7 +347,21 @@ void Unpack::DoUnpack(uint Method,bool Solid)
           }
       }
 #endif
-      Unpack5(Solid);
+#ifdef RAR_TEST_HOOKS
+      if (ForceWinType && ForcedWinType==UNPWIN_GENERIC)
+      {
+        Unpack5<UNPWIN_GENERIC>(Solid);
+        break;
+      }
+#endif
+      // Select the decoder specialized for current window type.
+      if (Fragmented)
+        Unpack5<UNPWIN_FRAGMENTED>(Solid);
+      else
+        if (Mirrored)
+          Unpack5<UNPWIN_MIRRORED>(Solid);
+        else
+          Unpack5<UNPWIN_NORMAL>(Solid);
       break;
   }
 }
@@ -295,6 +483,7 @@ void Unpack::MakeDecodeTables(byte *LengthTable,DecodeTable *Dec,uint Size)
     case NC:
     case NC20:
     case NC30:
+    case MC20:
       Dec->QuickBits=MAX_QUICK_DECODE_BITS;
       break;
     default:
@@ -352,3 +541,210 @@ void Unpack::MakeDecodeTables(byte *LengthTable,DecodeTable *Dec,uint Size)
     }
   }
 }
+
+
+// Prepare the table to decode two literals in one lookup. Literal codes
+// are short for text and similar data, so two of them often fit
+// to QUICK_PAIR_BITS.
+void Unpack::MakeLitPairTable(DecodeTable *Dec,uint *LitPair)
+{
+  // Code of QuickBits or less length can be found in QuickLen and QuickNum.
+  // If we know only first N bits of bit field, such code is defined
+  // correctly, when its length does not exceed N.
+  uint QuickLimit=Dec->DecodeLen[Dec->QuickBits];
+  for (uint Code=0;Code<(1<<QUICK_PAIR_BITS);Code++)
+  {
+    LitPair[Code]=0;
+
+    uint BitField=Code<<(16-QUICK_PAIR_BITS);
+    if (BitField>=QuickLimit)
+      continue;
+    uint Quick=BitField>>(16-Dec->QuickBits);
+    uint Length1=Dec->QuickLen[Quick],Literal1=Dec->QuickNum[Quick];
+    if (Literal1>=256 || Length1>=QUICK_PAIR_BITS)
+      continue;
+
+    BitField=(BitField<<Length1) & 0xffff;
+    if (BitField>=QuickLimit)
+      continue;
+    Quick=BitField>>(16-Dec->QuickBits);
+    uint Length2=Dec->QuickLen[Quick],Literal2=Dec->QuickNum[Quick];
+    if (Literal2>=256 || Length1+Length2>QUICK_PAIR_BITS)
+      continue;
+
+    LitPair[Code]=Literal1|(Literal2<<8)|((Length1+Length2)<<16);
+  }
+}
+
+
+#ifdef USE_SSE
+// Byte-wise running sum of all preceding bytes in vector.
+SSE_FUNCTION("sse2")
+static inline __m128i DeltaPrefixSum(__m128i X)
+{
+  X=_mm_add_epi8(X,_mm_slli_si128(X,1));
+  X=_mm_add_epi8(X,_mm_slli_si128(X,2));
+  X=_mm_add_epi8(X,_mm_slli_si128(X,4));
+  return _mm_add_epi8(X,_mm_slli_si128(X,8));
+}
+
+
+// Decode next 16 bytes of channel and set Prev to its last byte in all lanes.
+SSE_FUNCTION("sse2")
+static inline __m128i DeltaDecode16(const byte *Src,__m128i &Prev)
+{
+  __m128i D=_mm_sub_epi8(Prev,DeltaPrefixSum(_mm_loadu_si128((__m128i *)Src)));
+  __m128i Last=_mm_unpackhi_epi8(D,D);
+  Last=_mm_shufflehi_epi16(Last,0xff);
+  Prev=_mm_unpackhi_epi64(Last,Last);
+  return D;
+}
+
+
+// Decode 16 bytes of every channel at once and interleave them with
+// unpack or shuffle instructions. Return the number of bytes decoded
+// in every channel.
+SSE_FUNCTION("ssse3")
+static uint DeltaFilter_SSE(byte *Dst,const byte *Src,uint DataSize,uint Channels)
+{
+  // Pshufb masks to place bytes of 3 channels to 3 output vectors.
+  static const char Mask3[3][3][16]={
+    {{0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1,-1,5},{-1,0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1,-1},{-1,-1,0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1}},
+    {{-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1,10,-1},{5,-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1,10},{-1,5,-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1}},
+    {{-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1,-1},{-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1},{10,-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15}}
+  };
+
+  uint ChLength=DataSize/Channels,Remainder=DataSize%Channels;
+  const byte *ChSrc[4];
+  __m128i Prev[4],D[4];
+  for (uint I=0;I<Channels;I++)
+  {
+    ChSrc[I]=Src+I*ChLength+Min(I,Remainder);
+    Prev[I]=_mm_setzero_si128();
+  }
+
+  uint Pos=0;
+  for (;Pos+16<=ChLength;Pos+=16,Dst+=16*Channels)
+  {
+    for (uint I=0;I<Channels;I++)
+      D[I]=DeltaDecode16(ChSrc[I]+Pos,Prev[I]);
+    __m128i *Out=(__m128i *)Dst;
+    switch(Channels)
+    {
+      case 1:
+        _mm_storeu_si128(Out,D[0]);
+        break;
+      case 2:
+        _mm_storeu_si128(Out,_mm_unpacklo_epi8(D[0],D[1]));
+        _mm_storeu_si128(Out+1,_mm_unpackhi_epi8(D[0],D[1]));
+        break;
+      case 3:
+        for (uint I=0;I<3;I++)
+        {
+          __m128i R=_mm_shuffle_epi8(D[0],_mm_loadu_si128((__m128i *)Mask3[I][0]));
+          R=_mm_or_si128(R,_mm_shuffle_epi8(D[1],_mm_loadu_si128((__m128i *)Mask3[I][1])));
+          R=_mm_or_si128(R,_mm_shuffle_epi8(D[2],_mm_loadu_si128((__m128i *)Mask3[I][2])));
+          _mm_storeu_si128(Out+I,R);
+        }
+        break;
+      case 4:
+        {
+          __m128i L01=_mm_unpacklo_epi8(D[0],D[1]),H01=_mm_unpackhi_epi8(D[0],D[1]);
+          __m128i L23=_mm_unpacklo_epi8(D[2],D[3]),H23=_mm_unpackhi_epi8(D[2],D[3]);
+          _mm_storeu_si128(Out,_mm_unpacklo_epi16(L01,L23));
+          _mm_storeu_si128(Out+1,_mm_unpackhi_epi16(L01,L23));
+          _mm_storeu_si128(Out+2,_mm_unpacklo_epi16(H01,H23));
+          _mm_storeu_si128(Out+3,_mm_unpackhi_epi16(H01,H23));
+        }
+        break;
+    }
+  }
+  return Pos;
+}
+#endif
+
+
+#ifdef USE_NEON
+static uint DeltaFilter_NEON(byte *Dst,const byte *Src,uint DataSize,uint Channels)
+{
+  uint ChLength=DataSize/Channels,Remainder=DataSize%Channels;
+  const byte *ChSrc[4];
+  uint8x16_t Prev[4],D[4];
+  const uint8x16_t Zero=vdupq_n_u8(0);
+  for (uint I=0;I<Channels;I++)
+  {
+    ChSrc[I]=Src+I*ChLength+Min(I,Remainder);
+    Prev[I]=Zero;
+  }
+
+  uint Pos=0;
+  for (;Pos+16<=ChLength;Pos+=16,Dst+=16*Channels)
+  {
+    for (uint I=0;I<Channels;I++)
+    {
+      // Byte-wise running sum of all preceding bytes in vector.
+      uint8x16_t X=vld1q_u8(ChSrc[I]+Pos);
+      X=vaddq_u8(X,vextq_u8(Zero,X,15));
+      X=vaddq_u8(X,vextq_u8(Zero,X,14));
+      X=vaddq_u8(X,vextq_u8(Zero,X,12));
+      X=vaddq_u8(X,vextq_u8(Zero,X,8));
+      D[I]=vsubq_u8(Prev[I],X);
+      Prev[I]=vdupq_laneq_u8(D[I],15);
+    }
+    switch(Channels)
+    {
+      case 1:
+        vst1q_u8(Dst,D[0]);
+        break;
+      case 2:
+        {
+          uint8x16x2_t V={{D[0],D[1]}};
+          vst2q_u8(Dst,V);
+        }
+        break;
+      case 3:
+        {
+          uint8x16x3_t V={{D[0],D[1],D[2]}};
+          vst3q_u8(Dst,V);
+        }
+        break;
+      case 4:
+        {
+          uint8x16x4_t V={{D[0],D[1],D[2],D[3]}};
+          vst4q_u8(Dst,V);
+        }
+        break;
+    }
+  }
+  return Pos;
+}
+#endif
+
+
+void UnpackDeltaFilter(byte *Dst,const byte *Src,uint DataSize,uint Channels,bool Vectorized)
+{
+  // Number of already decoded bytes in every channel.
+  uint Decoded=0;
+
+  // Vectorized code processes up to 4 channels, which are typical
+  // for audio and image data.
+#if defined(USE_SSE)
+  if (Vectorized && Channels<=4 && _SSE_Version>=SSE_SSSE3)
+    Decoded=DeltaFilter_SSE(Dst,Src,DataSize,Channels);
+#elif defined(USE_NEON)
+  if (Vectorized && Channels<=4)
+    Decoded=DeltaFilter_NEON(Dst,Src,DataSize,Channels);
+#endif
+
+  // Bytes from same channels are grouped to continual data blocks,
+  // so we need to place them back to their interleaving positions.
+  uint SrcPos=0;
+  for (uint CurChannel=0;CurChannel<Channels;CurChannel++)
+  {
+    uint DestPos=CurChannel+Decoded*Channels;
+    byte PrevByte=Decoded>0 ? Dst[DestPos-Channels]:0;
+    SrcPos+=Decoded;
+    for (;DestPos<DataSize;DestPos+=Channels)
+      Dst[DestPos]=(PrevByte-=Src[SrcPos++]);
+  }
+}
@@ -4,6 +4,9 @@
 // Maximum allowed number of compressed bits processed in quick mode.
 #define MAX_QUICK_DECODE_BITS      10
 
+// Number of compressed bits used to decode two literals at once.
+#define QUICK_PAIR_BITS            12
+
 // Maximum number of filters per entire data block. Must be at least
 // twice more than MAX_PACK_FILTERS to store filters from two data blocks.
 #define MAX_UNPACK_FILTERS       8192
@@ -88,9 +91,42 @@ struct UnpackBlockTables
   DecodeTable LDD; // Decode lower bits of distances.
   DecodeTable RD;  // Decode repeating distances.
   DecodeTable BD;  // Decode bit lengths in Huffman table.
+
+  // Two literals decoded from QUICK_PAIR_BITS bits of literal table code.
+  // Lower 16 bits contain literals and upper bits contain their total
+  // code length. Zero if these bits do not start with two short literals.
+  uint LitPair[1<<QUICK_PAIR_BITS];
+};
+
+
+// How the sliding dictionary memory is allocated.
+enum WINDOW_MEM_TYPE {
+  WINMEM_HEAP,WINMEM_MAPPED,WINMEM_MIRROR
+};
+
+
+// How the sliding dictionary is accessed. We pass it as template parameter
+// to RAR 5.0 decoder, so the window type is checked once per file instead
+// of every literal and match.
+enum UNPACK_WINDOW_TYPE {
+  UNPWIN_NORMAL,UNPWIN_MIRRORED,UNPWIN_FRAGMENTED,
+#ifdef RAR_TEST_HOOKS
+  UNPWIN_GENERIC // Decoder checks the window type at run time.
+#endif
 };
 
 
+#ifdef RAR_TEST_HOOKS
+// Test builds only. Force the window type for dictionaries allocated later,
+// so all RAR 5.0 decoder variants can be tested on any platform. Fragmented
+// window is used only for dictionaries of 16 MB and larger. UNPWIN_GENERIC
+// keeps the usual window, but selects the generic decoder to compare its
+// speed. Not thread safe, call only when nothing is extracted.
+void SetUnpackWindowType(UNPACK_WINDOW_TYPE Type);
+void ResetUnpackWindowType();
+#endif
+
+
 #ifdef RAR_SMP
 enum UNP_DEC_TYPE {
   UNPDT_LITERAL,UNPDT_MATCH,UNPDT_FULLREP,UNPDT_REP,UNPDT_FILTER
@@ -108,6 +144,16 @@ struct UnpackDecodedItem
 };
 
 
+// Match postponed by multithreaded LZ processing, because it references
+// data of preceding blocks, which are processed in other threads.
+struct UnpackDeferredItem
+{
+  uint Dest; // Offset from beginning of block output.
+  uint Length;
+  uint Distance;
+};
+
+
 struct UnpackThreadData
 {
   Unpack *UnpackPtr;
@@ -127,15 +173,29 @@ struct UnpackThreadData
   uint DecodedAllocated;
   uint ThreadNumber; // For debugging.
 
+  // Multithreaded LZ processing data.
+  size_t WinStart;   // Window position of block output.
+  uint SegStart;     // Offset of block output from beginning of segment.
+  uint OutSize;      // Size of block output.
+  int64 MinSrc;      // Lowest match source offset relative to block start.
+  uint FilterCount;
+  UnpackDeferredItem *Deferred;
+  uint DeferredSize;
+  uint DeferredAllocated;
+  uint DeferredData; // Total length of deferred matches.
+
   UnpackThreadData()
   :Inp(false)
   {
     Decoded=NULL;
+    Deferred=NULL;
+    DeferredAllocated=0;
   }
   ~UnpackThreadData()
   {
-    if (Decoded!=NULL)
-      free(Decoded);
+    MemPoolFree(Decoded,DecodedAllocated*sizeof(UnpackDecodedItem));
+    if (Deferred!=NULL)
+      free(Deferred);
   }
 };
 #endif
@@ -153,6 +213,11 @@ struct UnpackFilter
 };
 
 
+// Restore DELTA filter data of RAR 3.x and 5.0 formats from Src to Dst.
+// Vectorized=false selects the scalar code to compare with vector results.
+void UnpackDeltaFilter(byte *Dst,const byte *Src,uint DataSize,uint Channels,bool Vectorized=true);
+
+
 struct UnpackFilter30
 {
   unsigned int BlockStart;
@@ -167,12 +232,19 @@ struct UnpackFilter30
 };
 
 
+// Static Huffman table of RAR 1.5 format. Defined in unpack15.cpp.
+struct DecodeTable15;
+
+
+// Number of predictors evaluated in RAR 2.0 audio compression.
+#define AUDIO_PREDICTORS  11
+
 struct AudioVariables // For RAR 2.0 archives only.
 {
   int K1,K2,K3,K4,K5;
   int D1,D2,D3,D4;
   int LastDelta;
-  unsigned int Dif[11];
+  unsigned int Dif[AUDIO_PREDICTORS+1]; // Extra item is padding for SIMD code.
   unsigned int ByteCount;
   int LastChar;
 };
@@ -188,10 +260,16 @@ class FragmentedWindow
     void Reset();
     byte *Mem[MAX_MEM_BLOCKS];
     size_t MemSize[MAX_MEM_BLOCKS];
+#ifdef RAR_TEST_HOOKS
+    size_t MaxBlockSize; // Do not allocate larger blocks if not 0.
+#endif
   public:
     FragmentedWindow();
     ~FragmentedWindow();
     void Init(size_t WinSize);
+#ifdef RAR_TEST_HOOKS
+    void SetMaxBlockSize(size_t Size) {MaxBlockSize=Size;}
+#endif
     byte& operator [](size_t Item);
     void CopyString(uint Length,uint Distance,size_t &UnpPtr,size_t MaxWinMask);
     void CopyData(byte *Dest,size_t WinPos,size_t Size);
@@ -203,7 +281,7 @@ class Unpack:PackDef
 {
   private:
 
-    void Unpack5(bool Solid);
+    template <UNPACK_WINDOW_TYPE WinType> void Unpack5(bool Solid);
     void Unpack5MT(bool Solid);
     bool UnpReadBuf();
     void UnpWriteBuf();
@@ -215,11 +293,18 @@ class Unpack:PackDef
     bool ReadBlockHeader(BitInput &Inp,UnpackBlockHeader &Header);
     bool ReadTables(BitInput &Inp,UnpackBlockHeader &Header,UnpackBlockTables &Tables);
     void MakeDecodeTables(byte *LengthTable,DecodeTable *Dec,uint Size);
+    void MakeLitPairTable(DecodeTable *Dec,uint *LitPair);
     _forceinline uint DecodeNumber(BitInput &Inp,DecodeTable *Dec);
     void CopyString();
     inline void InsertOldDist(unsigned int Distance);
     void UnpInitData(bool Solid);
     _forceinline void CopyString(uint Length,uint Distance);
+    template <UNPACK_WINDOW_TYPE WinType> _forceinline void CopyString(uint Length,uint Distance);
+#ifdef RAR_TEST_HOOKS
+    template <UNPACK_WINDOW_TYPE WinType> bool IsFragmented() {return WinType==UNPWIN_GENERIC ? Fragmented:WinType==UNPWIN_FRAGMENTED;}
+#else
+    template <UNPACK_WINDOW_TYPE WinType> bool IsFragmented() {return WinType==UNPWIN_FRAGMENTED;}
+#endif
     uint ReadFilterData(BitInput &Inp);
     bool ReadFilter(BitInput &Inp,UnpackFilter &Filter);
     bool AddFilter(UnpackFilter &Filter);
@@ -231,13 +316,38 @@ class Unpack:PackDef
 
 #ifdef RAR_SMP
     void InitMT();
+    void GrowReadBufMT(int NewSize,int DataSize);
+    void Unpack5MTLoop(bool Solid);
+    void MoveReadBufMT(byte *NewBuf,int DataSize);
+    int UnpReadMT(int DataSize);
+    void StartReadAheadMT();
+    int WaitReadAheadMT();
+    void StopReadAheadMT(bool Discard);
     bool UnpackLargeBlock(UnpackThreadData &D);
     bool ProcessDecoded(UnpackThreadData &D);
+    bool ProcessDecodedBlocks(uint BlockCount,uint &Processed);
+    void ResolveDecoded(UnpackThreadData &D,bool Commit);
 
     ThreadPool *UnpThreadPool;
     UnpackThreadData *UnpThreadData;
     uint MaxUserThreads;
-    byte *ReadBufMT;
+    byte *ReadBufMT;   // Start of not processed data in ReadBufMTMem.
+    byte *ReadBufMTMem;
+    int ReadBufMTSize; // Buffer size excluding the gap and overflow area.
+
+    // 'true' if most of matches reference data of preceding blocks,
+    // so we process decoded data in single thread until the end of file.
+    bool SingleLZMT;
+
+    // Packed data read in advance by I/O thread to the second buffer,
+    // while other threads decode and process the previously read data.
+    // Then we swap buffers instead of copying the read data.
+    IOThread *ReadAheadThread;
+    byte *ReadAheadBuf;
+    int ReadAheadBufSize;
+    int ReadAheadCount;  // Number of bytes requested in I/O thread.
+    int ReadAheadResult; // UnpReadAhead result in I/O thread.
+    bool ReadAheadActive;
 #endif
 
     Array<byte> FilterSrcMemory;
@@ -273,6 +383,12 @@ class Unpack:PackDef
     FragmentedWindow FragWindow;
     bool Fragmented;
 
+    WINDOW_MEM_TYPE WinMemType;
+
+    // Window memory is mapped twice to adjacent addresses, so up to
+    // MaxWinSize bytes after Window+MaxWinSize mirror the window start.
+    bool Mirrored;
+
 
     int64 DestUnpSize;
 
@@ -293,7 +409,7 @@ class Unpack:PackDef
     void InitHuff();
     void CorrHuff(ushort *CharSet,byte *NumToPlace);
     void CopyString15(uint Distance,uint Length);
-    uint DecodeNum(uint Num,uint StartPos,uint *DecTab,uint *PosTab);
+    _forceinline uint DecodeNum(uint Num,const DecodeTable15 *Dec);
 
     ushort ChSet[256],ChSetA[256],ChSetB[256],ChSetC[256];
     byte NToPl[256],NToPlB[256],NToPlC[256];
@@ -316,7 +432,7 @@ class Unpack:PackDef
     void UnpWriteBuf20();
     void UnpInitData20(int Solid);
     void ReadLastTables();
-    byte DecodeAudio(int Delta);
+    _forceinline byte DecodeAudio(int Delta);
     struct AudioVariables AudV[4];
 /***************************** Unpack v 2.0 *********************************/
 
@@ -382,11 +498,13 @@ class Unpack:PackDef
     void SetSuspended(bool Suspended) {Unpack::Suspended=Suspended;}
 
 #ifdef RAR_SMP
-    // More than 8 threads are unlikely to provide a noticeable gain
-    // for unpacking, but would use the additional memory.
-    void SetThreads(uint Threads) {MaxUserThreads=Min(Threads,8);}
+    // Every thread uses the additional memory for decoded data,
+    // so we limit it to the maximum number of pool threads.
+    void SetThreads(uint Threads) {MaxUserThreads=Min(Threads,MaxPoolThreads);}
 
     void UnpackDecode(UnpackThreadData &D);
+    void ProcessDecodedMT(UnpackThreadData &D);
+    void ReadAheadMT();
 #endif
 
     size_t MaxWinSize;
@@ -1,40 +1,134 @@
 #define STARTL1  2
-static unsigned int DecL1[]={0x8000,0xa000,0xc000,0xd000,0xe000,0xea00,
-                             0xee00,0xf000,0xf200,0xf200,0xffff};
-static unsigned int PosL1[]={0,0,0,2,3,5,7,11,16,20,24,32,32};
+static constexpr uint DecL1[]={0x8000,0xa000,0xc000,0xd000,0xe000,0xea00,
+                               0xee00,0xf000,0xf200,0xf200,0xffff};
+static constexpr uint PosL1[]={0,0,0,2,3,5,7,11,16,20,24,32,32};
 
 #define STARTL2  3
-static unsigned int DecL2[]={0xa000,0xc000,0xd000,0xe000,0xea00,0xee00,
-                             0xf000,0xf200,0xf240,0xffff};
-static unsigned int PosL2[]={0,0,0,0,5,7,9,13,18,22,26,34,36};
+static constexpr uint DecL2[]={0xa000,0xc000,0xd000,0xe000,0xea00,0xee00,
+                               0xf000,0xf200,0xf240,0xffff};
+static constexpr uint PosL2[]={0,0,0,0,5,7,9,13,18,22,26,34,36};
 
 #define STARTHF0  4
-static unsigned int DecHf0[]={0x8000,0xc000,0xe000,0xf200,0xf200,0xf200,
-                              0xf200,0xf200,0xffff};
-static unsigned int PosHf0[]={0,0,0,0,0,8,16,24,33,33,33,33,33};
+static constexpr uint DecHf0[]={0x8000,0xc000,0xe000,0xf200,0xf200,0xf200,
+                                0xf200,0xf200,0xffff};
+static constexpr uint PosHf0[]={0,0,0,0,0,8,16,24,33,33,33,33,33};
 
 
 #define STARTHF1  5
-static unsigned int DecHf1[]={0x2000,0xc000,0xe000,0xf000,0xf200,0xf200,
-                              0xf7e0,0xffff};
-static unsigned int PosHf1[]={0,0,0,0,0,0,4,44,60,76,80,80,127};
+static constexpr uint DecHf1[]={0x2000,0xc000,0xe000,0xf000,0xf200,0xf200,
+                                0xf7e0,0xffff};
+static constexpr uint PosHf1[]={0,0,0,0,0,0,4,44,60,76,80,80,127};
 
 
 #define STARTHF2  5
-static unsigned int DecHf2[]={0x1000,0x2400,0x8000,0xc000,0xfa00,0xffff,
-                              0xffff,0xffff};
-static unsigned int PosHf2[]={0,0,0,0,0,0,2,7,53,117,233,0,0};
+static constexpr uint DecHf2[]={0x1000,0x2400,0x8000,0xc000,0xfa00,0xffff,
+                                0xffff,0xffff};
+static constexpr uint PosHf2[]={0,0,0,0,0,0,2,7,53,117,233,0,0};
 
 
 #define STARTHF3  6
-static unsigned int DecHf3[]={0x800,0x2400,0xee00,0xfe80,0xffff,0xffff,
-                              0xffff};
-static unsigned int PosHf3[]={0,0,0,0,0,0,0,2,16,218,251,0,0};
+static constexpr uint DecHf3[]={0x800,0x2400,0xee00,0xfe80,0xffff,0xffff,
+                                0xffff};
+static constexpr uint PosHf3[]={0,0,0,0,0,0,0,2,16,218,251,0,0};
 
 
 #define STARTHF4  8
-static unsigned int DecHf4[]={0xff00,0xffff,0xffff,0xffff,0xffff,0xffff};
-static unsigned int PosHf4[]={0,0,0,0,0,0,0,0,0,255,0,0,0};
+static constexpr uint DecHf4[]={0xff00,0xffff,0xffff,0xffff,0xffff,0xffff};
+static constexpr uint PosHf4[]={0,0,0,0,0,0,0,0,0,255,0,0,0};
+
+
+// Number of bits decoded with a single lookup in RAR 1.5 static tables.
+#define QUICK_BITS15  8
+
+// RAR 1.5 static Huffman table. We build the quick lookup table in compile
+// time, so the most of codes, which are not longer than QUICK_BITS15,
+// are decoded without searching through DecTab.
+struct DecodeTable15
+{
+  uint StartPos;
+  const uint *DecTab,*PosTab;
+
+  // Lower 4 bits contain the code length and upper bits contain
+  // the decoded number. Zero if code is longer than QUICK_BITS15.
+  ushort Quick[1<<QUICK_BITS15];
+
+  constexpr DecodeTable15(uint StartPos,const uint *DecTab,const uint *PosTab) :
+    StartPos(StartPos),DecTab(DecTab),PosTab(PosTab),Quick()
+  {
+    for (uint Code=0;Code<ASIZE(Quick);Code++)
+    {
+      uint Num=Code<<(16-QUICK_BITS15),Bits=StartPos,I=0;
+      for (;DecTab[I]<=Num;I++)
+        Bits++;
+      // Code not exceeding QUICK_BITS15 is defined by its bits only,
+      // so zero lower bits of Num do not affect the result.
+      if (Bits<=QUICK_BITS15)
+        Quick[Code]=ushort(((((Num-(I ? DecTab[I-1]:0))>>(16-Bits))+PosTab[Bits])<<4) | Bits);
+    }
+  }
+};
+
+static constexpr DecodeTable15 TabL1(STARTL1,DecL1,PosL1);
+static constexpr DecodeTable15 TabL2(STARTL2,DecL2,PosL2);
+static constexpr DecodeTable15 TabHf0(STARTHF0,DecHf0,PosHf0);
+static constexpr DecodeTable15 TabHf1(STARTHF1,DecHf1,PosHf1);
+static constexpr DecodeTable15 TabHf2(STARTHF2,DecHf2,PosHf2);
+static constexpr DecodeTable15 TabHf3(STARTHF3,DecHf3,PosHf3);
+static constexpr DecodeTable15 TabHf4(STARTHF4,DecHf4,PosHf4);
+
+
+// ShortLZ length codes for both AvrLn1 ranges and both Buf60 values, indexed
+// by 8 bit field. Lower 4 bits contain the length number and upper 4 bits
+// contain the code length.
+struct ShortCodes15
+{
+  byte Code[2][2][256];
+
+  constexpr ShortCodes15() : Code()
+  {
+    const uint ShortLen1[]={1,3,4,4,5,6,7,8,8,4,4,5,6,6,4};
+    const uint ShortXor1[]={0,0xa0,0xd0,0xe0,0xf0,0xf8,0xfc,0xfe,
+                            0xff,0xc0,0x80,0x90,0x98,0x9c,0xb0};
+    const uint ShortLen2[]={2,3,3,3,4,4,5,6,6,4,4,5,6,6,4};
+    const uint ShortXor2[]={0,0x40,0x60,0xa0,0xd0,0xe0,0xf0,0xf8,
+                            0xfc,0xc0,0x80,0x90,0x98,0x9c,0xb0};
+    for (uint Set=0;Set<2;Set++)
+      for (uint Buf60=0;Buf60<2;Buf60++)
+        for (uint BitField=0;BitField<256;BitField++)
+        {
+          const uint *ShortLen=Set==0 ? ShortLen1:ShortLen2;
+          const uint *ShortXor=Set==0 ? ShortXor1:ShortXor2;
+          // Codes are complete, so we always find the length here.
+          for (uint Length=0;Length<ASIZE(ShortLen1);Length++)
+          {
+            uint Bits=Length==(Set==0 ? 1:3) ? Buf60+3:ShortLen[Length];
+            if (((BitField^ShortXor[Length]) & (~(0xff>>Bits)))==0)
+            {
+              Code[Set][Buf60][BitField]=byte(Length|(Bits<<4));
+              break;
+            }
+          }
+        }
+  }
+};
+
+static constexpr ShortCodes15 ShortCodes;
+
+
+_forceinline uint Unpack::DecodeNum(uint Num,const DecodeTable15 *Dec)
+{
+  uint Quick=Dec->Quick[Num>>(16-QUICK_BITS15)];
+  if (Quick!=0)
+  {
+    Inp.faddbits(Quick & 0xf);
+    return Quick>>4;
+  }
+  uint I,StartPos=Dec->StartPos;
+  for (Num&=0xfff0,I=0;Dec->DecTab[I]<=Num;I++)
+    StartPos++;
+  Inp.faddbits(StartPos);
+  return(((Num-(I ? Dec->DecTab[I-1]:0))>>(16-StartPos))+Dec->PosTab[StartPos]);
+}
 
 
 void Unpack::Unpack15(bool Solid)
@@ -111,19 +205,8 @@ void Unpack::Unpack15(bool Solid)
 }
 
 
-#define GetShortLen1(pos) ((pos)==1 ? Buf60+3:ShortLen1[pos])
-#define GetShortLen2(pos) ((pos)==3 ? Buf60+3:ShortLen2[pos])
-
 void Unpack::ShortLZ()
 {
-  static unsigned int ShortLen1[]={1,3,4,4,5,6,7,8,8,4,4,5,6,6,4,0};
-  static unsigned int ShortXor1[]={0,0xa0,0xd0,0xe0,0xf0,0xf8,0xfc,0xfe,
-                                   0xff,0xc0,0x80,0x90,0x98,0x9c,0xb0};
-  static unsigned int ShortLen2[]={2,3,3,3,4,4,5,6,6,4,4,5,6,6,4,0};
-  static unsigned int ShortXor2[]={0,0x40,0x60,0xa0,0xd0,0xe0,0xf0,0xf8,
-                                   0xfc,0xc0,0x80,0x90,0x98,0x9c,0xb0};
-
-
   unsigned int Length,SaveLength;
   unsigned int LastDistance;
   unsigned int Distance;
@@ -143,25 +226,11 @@ void Unpack::ShortLZ()
     LCount=0;
   }
 
-  BitField>>=8;
+  BitField=(BitField>>8) & 0xff;
 
-//  not thread safe, replaced by GetShortLen1 and GetShortLen2 macro
-//  ShortLen1[1]=ShortLen2[3]=Buf60+3;
-
-  if (AvrLn1<37)
-  {
-    for (Length=0;;Length++)
-      if (((BitField^ShortXor1[Length]) & (~(0xff>>GetShortLen1(Length))))==0)
-        break;
-    Inp.faddbits(GetShortLen1(Length));
-  }
-  else
-  {
-    for (Length=0;;Length++)
-      if (((BitField^ShortXor2[Length]) & (~(0xff>>GetShortLen2(Length))))==0)
-        break;
-    Inp.faddbits(GetShortLen2(Length));
-  }
+  uint Code=ShortCodes.Code[AvrLn1<37 ? 0:1][Buf60 & 1][BitField];
+  Length=Code & 0xf;
+  Inp.faddbits(Code>>4);
 
   if (Length >= 9)
   {
@@ -174,7 +243,7 @@ void Unpack::ShortLZ()
     if (Length == 14)
     {
       LCount=0;
-      Length=DecodeNum(Inp.fgetbits(),STARTL2,DecL2,PosL2)+5;
+      Length=DecodeNum(Inp.fgetbits(),&TabL2)+5;
       Distance=(Inp.fgetbits()>>1) | 0x8000;
       Inp.faddbits(15);
       LastLength=Length;
@@ -186,7 +255,7 @@ void Unpack::ShortLZ()
     LCount=0;
     SaveLength=Length;
     Distance=OldDist[(OldDistPtr-(Length-9)) & 3];
-    Length=DecodeNum(Inp.fgetbits(),STARTL1,DecL1,PosL1)+2;
+    Length=DecodeNum(Inp.fgetbits(),&TabL1)+2;
     if (Length==0x101 && SaveLength==10)
     {
       Buf60 ^= 1;
@@ -209,7 +278,7 @@ void Unpack::ShortLZ()
   AvrLn1 += Length;
   AvrLn1 -= AvrLn1 >> 4;
 
-  DistancePlace=DecodeNum(Inp.fgetbits(),STARTHF2,DecHf2,PosHf2) & 0xff;
+  DistancePlace=DecodeNum(Inp.fgetbits(),&TabHf2) & 0xff;
   Distance=ChSetA[DistancePlace];
   if (--DistancePlace != -1)
   {
@@ -244,10 +313,10 @@ void Unpack::LongLZ()
 
   unsigned int BitField=Inp.fgetbits();
   if (AvrLn2 >= 122)
-    Length=DecodeNum(BitField,STARTL2,DecL2,PosL2);
+    Length=DecodeNum(BitField,&TabL2);
   else
     if (AvrLn2 >= 64)
-      Length=DecodeNum(BitField,STARTL1,DecL1,PosL1);
+      Length=DecodeNum(BitField,&TabL1);
     else
       if (BitField < 0x100)
       {
@@ -266,12 +335,12 @@ void Unpack::LongLZ()
 
   BitField=Inp.fgetbits();
   if (AvrPlcB > 0x28ff)
-    DistancePlace=DecodeNum(BitField,STARTHF2,DecHf2,PosHf2);
+    DistancePlace=DecodeNum(BitField,&TabHf2);
   else
     if (AvrPlcB > 0x6ff)
-      DistancePlace=DecodeNum(BitField,STARTHF1,DecHf1,PosHf1);
+      DistancePlace=DecodeNum(BitField,&TabHf1);
     else
-      DistancePlace=DecodeNum(BitField,STARTHF0,DecHf0,PosHf0);
+      DistancePlace=DecodeNum(BitField,&TabHf0);
 
   AvrPlcB += DistancePlace;
   AvrPlcB -= AvrPlcB >> 8;
@@ -328,18 +397,18 @@ void Unpack::HuffDecode()
   unsigned int BitField=Inp.fgetbits();
 
   if (AvrPlc > 0x75ff)
-    BytePlace=DecodeNum(BitField,STARTHF4,DecHf4,PosHf4);
+    BytePlace=DecodeNum(BitField,&TabHf4);
   else
     if (AvrPlc > 0x5dff)
-      BytePlace=DecodeNum(BitField,STARTHF3,DecHf3,PosHf3);
+      BytePlace=DecodeNum(BitField,&TabHf3);
     else
       if (AvrPlc > 0x35ff)
-        BytePlace=DecodeNum(BitField,STARTHF2,DecHf2,PosHf2);
+        BytePlace=DecodeNum(BitField,&TabHf2);
       else
         if (AvrPlc > 0x0dff)
-          BytePlace=DecodeNum(BitField,STARTHF1,DecHf1,PosHf1);
+          BytePlace=DecodeNum(BitField,&TabHf1);
         else
-          BytePlace=DecodeNum(BitField,STARTHF0,DecHf0,PosHf0);
+          BytePlace=DecodeNum(BitField,&TabHf0);
   BytePlace&=0xff;
   if (StMode)
   {
@@ -358,7 +427,7 @@ void Unpack::HuffDecode()
       {
         Length = (BitField & 0x4000) ? 4 : 3;
         Inp.faddbits(1);
-        Distance=DecodeNum(Inp.fgetbits(),STARTHF2,DecHf2,PosHf2);
+        Distance=DecodeNum(Inp.fgetbits(),&TabHf2);
         Distance = (Distance << 5) | (Inp.fgetbits() >> 11);
         Inp.faddbits(5);
         CopyString15(Distance,Length);
@@ -399,7 +468,7 @@ void Unpack::HuffDecode()
 void Unpack::GetFlagsBuf()
 {
   unsigned int Flags,NewFlagsPlace;
-  unsigned int FlagsPlace=DecodeNum(Inp.fgetbits(),STARTHF2,DecHf2,PosHf2);
+  unsigned int FlagsPlace=DecodeNum(Inp.fgetbits(),&TabHf2);
 
   // Our Huffman table stores 257 items and needs all them in other parts
   // of code such as when StMode is on, so the first item is control item.
@@ -471,19 +540,5 @@ void Unpack::CorrHuff(ushort *CharSet,byte *NumToPlace)
 void Unpack::CopyString15(uint Distance,uint Length)
 {
   DestUnpSize-=Length;
-  while (Length--)
-  {
-    Window[UnpPtr]=Window[(UnpPtr-Distance) & MaxWinMask];
-    UnpPtr=(UnpPtr+1) & MaxWinMask;
-  }
-}
-
-
-uint Unpack::DecodeNum(uint Num,uint StartPos,uint *DecTab,uint *PosTab)
-{
-  int I;
-  for (Num&=0xfff0,I=0;DecTab[I]<=Num;I++)
-    StartPos++;
-  Inp.faddbits(StartPos);
-  return(((Num-(I ? DecTab[I-1]:0))>>(16-StartPos))+PosTab[StartPos]);
+  CopyString(Length,Distance);
 }
@@ -62,6 +62,19 @@ void Unpack::Unpack20(bool Solid)
       continue;
     }
 
+    // Decode two literals at once if possible. We need to have at least
+    // two bytes left to unpack here, because we must not write beyond
+    // the end of file in solid stream.
+    uint LitPair=BlockTables.LitPair[Inp.getbits()>>(16-QUICK_PAIR_BITS)];
+    if (LitPair!=0 && DestUnpSize>0)
+    {
+      Inp.addbits(LitPair>>16);
+      Window[UnpPtr++]=(byte)LitPair;
+      Window[UnpPtr++ & MaxWinMask]=(byte)(LitPair>>8);
+      DestUnpSize-=2;
+      continue;
+    }
+
     uint Number=DecodeNumber(Inp,&BlockTables.LD);
     if (Number<256)
     {
@@ -246,6 +259,7 @@ bool Unpack::ReadTables20()
   else
   {
     MakeDecodeTables(&Table[0],&BlockTables.LD,NC20);
+    MakeLitPairTable(&BlockTables.LD,BlockTables.LitPair);
     MakeDecodeTables(&Table[NC20],&BlockTables.DD,DC20);
     MakeDecodeTables(&Table[NC20+DC20],&BlockTables.RD,RC20);
   }
@@ -303,17 +317,36 @@ byte Unpack::DecodeAudio(int Delta)
   // so we cast it to unsigned to follow the standard.
   D=(uint)D<<3;
 
-  V->Dif[0]+=abs(D);
-  V->Dif[1]+=abs(D-V->D1);
-  V->Dif[2]+=abs(D+V->D1);
-  V->Dif[3]+=abs(D-V->D2);
-  V->Dif[4]+=abs(D+V->D2);
-  V->Dif[5]+=abs(D-V->D3);
-  V->Dif[6]+=abs(D+V->D3);
-  V->Dif[7]+=abs(D-V->D4);
-  V->Dif[8]+=abs(D+V->D4);
-  V->Dif[9]+=abs(D-UnpChannelDelta);
-  V->Dif[10]+=abs(D+UnpChannelDelta);
+#ifdef USE_SSE
+  if (_SSE_Version>=SSE_SSE2)
+  {
+    // Accumulate errors of all 11 predictors with 3 vectors. We calculate
+    // abs(D-Pred) as (X^Sign)-Sign, because SSE2 has no integer abs.
+    __m128i DV=_mm_set1_epi32(D);
+    __m128i X0=_mm_sub_epi32(DV,_mm_setr_epi32(0,V->D1,-V->D1,V->D2));
+    __m128i X1=_mm_sub_epi32(DV,_mm_setr_epi32(-V->D2,V->D3,-V->D3,V->D4));
+    __m128i X2=_mm_sub_epi32(DV,_mm_setr_epi32(-V->D4,UnpChannelDelta,-UnpChannelDelta,0));
+    __m128i S0=_mm_srai_epi32(X0,31),S1=_mm_srai_epi32(X1,31),S2=_mm_srai_epi32(X2,31);
+    __m128i *Dif=(__m128i *)V->Dif;
+    _mm_storeu_si128(Dif+0,_mm_add_epi32(_mm_loadu_si128(Dif+0),_mm_sub_epi32(_mm_xor_si128(X0,S0),S0)));
+    _mm_storeu_si128(Dif+1,_mm_add_epi32(_mm_loadu_si128(Dif+1),_mm_sub_epi32(_mm_xor_si128(X1,S1),S1)));
+    _mm_storeu_si128(Dif+2,_mm_add_epi32(_mm_loadu_si128(Dif+2),_mm_sub_epi32(_mm_xor_si128(X2,S2),S2)));
+  }
+  else
+#endif
+  {
+    V->Dif[0]+=abs(D);
+    V->Dif[1]+=abs(D-V->D1);
+    V->Dif[2]+=abs(D+V->D1);
+    V->Dif[3]+=abs(D-V->D2);
+    V->Dif[4]+=abs(D+V->D2);
+    V->Dif[5]+=abs(D-V->D3);
+    V->Dif[6]+=abs(D+V->D3);
+    V->Dif[7]+=abs(D-V->D4);
+    V->Dif[8]+=abs(D+V->D4);
+    V->Dif[9]+=abs(D-UnpChannelDelta);
+    V->Dif[10]+=abs(D+UnpChannelDelta);
+  }
 
   UnpChannelDelta=V->LastDelta=(signed char)(Ch-V->LastChar);
   V->LastChar=Ch;
@@ -322,7 +355,7 @@ byte Unpack::DecodeAudio(int Delta)
   {
     uint MinDif=V->Dif[0],NumMinDif=0;
     V->Dif[0]=0;
-    for (uint I=1;I<ASIZE(V->Dif);I++)
+    for (uint I=1;I<AUDIO_PREDICTORS;I++)
     {
       if (V->Dif[I]<MinDif)
       {
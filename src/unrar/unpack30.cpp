@@ -133,6 +133,16 @@ void Unpack::Unpack29(bool Solid)
       continue;
     }
 
+    // Decode two literals at once if possible.
+    uint LitPair=BlockTables.LitPair[Inp.getbits()>>(16-QUICK_PAIR_BITS)];
+    if (LitPair!=0)
+    {
+      Inp.addbits(LitPair>>16);
+      Window[UnpPtr++]=(byte)LitPair;
+      Window[UnpPtr++ & MaxWinMask]=(byte)(LitPair>>8);
+      continue;
+    }
+
     uint Number=DecodeNumber(Inp,&BlockTables.LD);
     if (Number<256)
     {
@@ -727,6 +737,7 @@ bool Unpack::ReadTables30()
   if (Inp.InAddr>ReadTop)
     return false;
   MakeDecodeTables(&Table[0],&BlockTables.LD,NC30);
+  MakeLitPairTable(&BlockTables.LD,BlockTables.LitPair);
   MakeDecodeTables(&Table[NC30],&BlockTables.DD,DC30);
   MakeDecodeTables(&Table[NC30+DC30],&BlockTables.LDD,LDC30);
   MakeDecodeTables(&Table[NC30+DC30+LDC30],&BlockTables.RD,RC30);
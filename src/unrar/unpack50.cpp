@@ -1,4 +1,4 @@
-void Unpack::Unpack5(bool Solid)
+template <UNPACK_WINDOW_TYPE WinType> void Unpack::Unpack5(bool Solid)
 {
   FileExtracted=true;
 
@@ -54,10 +54,24 @@ void Unpack::Unpack5(bool Solid)
       }
     }
 
+    // Decode two literals at once if we are far enough from block end,
+    // so the second literal is not read beyond it.
+    if (Inp.InAddr<ReadBorder-2 && !IsFragmented<WinType>())
+    {
+      uint LitPair=BlockTables.LitPair[Inp.getbits()>>(16-QUICK_PAIR_BITS)];
+      if (LitPair!=0)
+      {
+        Inp.addbits(LitPair>>16);
+        Window[UnpPtr++]=(byte)LitPair;
+        Window[UnpPtr++ & MaxWinMask]=(byte)(LitPair>>8);
+        continue;
+      }
+    }
+
     uint MainSlot=DecodeNumber(Inp,&BlockTables.LD);
     if (MainSlot<256)
     {
-      if (Fragmented)
+      if (IsFragmented<WinType>())
         FragWindow[UnpPtr++]=(byte)MainSlot;
       else
         Window[UnpPtr++]=(byte)MainSlot;
@@ -111,10 +125,7 @@ void Unpack::Unpack5(bool Solid)
 
       InsertOldDist(Distance);
       LastLength=Length;
-      if (Fragmented)
-        FragWindow.CopyString(Length,Distance,UnpPtr,MaxWinMask);
-      else
-        CopyString(Length,Distance);
+      CopyString<WinType>(Length,Distance);
       continue;
     }
     if (MainSlot==256)
@@ -127,10 +138,7 @@ void Unpack::Unpack5(bool Solid)
     if (MainSlot==257)
     {
       if (LastLength!=0)
-        if (Fragmented)
-          FragWindow.CopyString(LastLength,OldDist[0],UnpPtr,MaxWinMask);
-        else
-          CopyString(LastLength,OldDist[0]);
+        CopyString<WinType>(LastLength,OldDist[0]);
       continue;
     }
     if (MainSlot<262)
@@ -144,10 +152,7 @@ void Unpack::Unpack5(bool Solid)
       uint LengthSlot=DecodeNumber(Inp,&BlockTables.RD);
       uint Length=SlotToLength(Inp,LengthSlot);
       LastLength=Length;
-      if (Fragmented)
-        FragWindow.CopyString(Length,Distance,UnpPtr,MaxWinMask);
-      else
-        CopyString(Length,Distance);
+      CopyString<WinType>(Length,Distance);
       continue;
     }
   }
@@ -261,10 +266,11 @@ void Unpack::UnpWriteBuf()
   for (size_t I=0;I<Filters.Size();I++)
   {
     // Here we apply filters to data which we need to write.
-    // We always copy data to another memory block before processing.
     // We cannot process them just in place in Window buffer, because
     // these data can be used for future string matches, so we must
-    // preserve them in original form.
+    // preserve them in original form. Filters modifying their source data
+    // get a copy of it. Others read data directly from window if it is
+    // stored in contiguous memory block.
 
     UnpackFilter *flt=&Filters[I];
     if (flt->Type==FILTER_NONE)
@@ -302,28 +308,43 @@ void Unpack::UnpWriteBuf()
         if (BlockLength>0) // We set it to 0 also for invalid filters.
         {
           uint BlockEnd=(BlockStart+BlockLength)&MaxWinMask;
+          bool Contiguous=BlockStart<BlockEnd || BlockEnd==0 || Mirrored;
 
-          FilterSrcMemory.Alloc(BlockLength);
-          byte *Mem=&FilterSrcMemory[0];
-          if (BlockStart<BlockEnd || BlockEnd==0)
+          byte *Mem=NULL;
+          if (Contiguous && flt->Type==FILTER_DELTA)
           {
-            if (Fragmented)
-              FragWindow.CopyData(Mem,BlockStart,BlockLength);
+            // DELTA filter does not modify its source data, so we can pass
+            // window memory to it directly, avoiding the extra copy.
+            if (!Fragmented)
+              Mem=Window+BlockStart;
             else
-              memcpy(Mem,Window+BlockStart,BlockLength);
+              if (FragWindow.GetBlockSize(BlockStart,BlockLength)==BlockLength)
+                Mem=&FragWindow[BlockStart];
           }
-          else
+          if (Mem==NULL)
           {
-            size_t FirstPartLength=size_t(MaxWinSize-BlockStart);
-            if (Fragmented)
+            FilterSrcMemory.Alloc(BlockLength);
+            Mem=&FilterSrcMemory[0];
+            if (Contiguous)
             {
-              FragWindow.CopyData(Mem,BlockStart,FirstPartLength);
-              FragWindow.CopyData(Mem+FirstPartLength,0,BlockEnd);
+              if (Fragmented)
+                FragWindow.CopyData(Mem,BlockStart,BlockLength);
+              else
+                memcpy(Mem,Window+BlockStart,BlockLength);
             }
             else
             {
-              memcpy(Mem,Window+BlockStart,FirstPartLength);
-              memcpy(Mem+FirstPartLength,Window,BlockEnd);
+              size_t FirstPartLength=size_t(MaxWinSize-BlockStart);
+              if (Fragmented)
+              {
+                FragWindow.CopyData(Mem,BlockStart,FirstPartLength);
+                FragWindow.CopyData(Mem+FirstPartLength,0,BlockEnd);
+              }
+              else
+              {
+                memcpy(Mem,Window+BlockStart,FirstPartLength);
+                memcpy(Mem+FirstPartLength,Window,BlockEnd);
+              }
             }
           }
 
@@ -395,6 +416,143 @@ void Unpack::UnpWriteBuf()
 }
 
 
+// Return the position of first 0xe8 or CmpByte2 byte in [Pos,End) range
+// or End if there is no such byte.
+static inline uint FindE8Generic(const byte *Data,uint Pos,uint End,byte CmpByte2)
+{
+  for (;Pos<End;Pos++)
+    if (Data[Pos]==0xe8 || Data[Pos]==CmpByte2)
+      break;
+  return Pos;
+}
+
+
+#ifdef USE_SSE
+// Return the number of trailing zero bits in non-zero Mask.
+static inline uint TrailingZeros(uint Mask)
+{
+#ifdef _MSC_VER
+  unsigned long Index;
+  _BitScanForward(&Index,Mask);
+  return (uint)Index;
+#else
+  return __builtin_ctz(Mask);
+#endif
+}
+
+
+SSE_FUNCTION("sse2")
+static uint FindE8_SSE2(const byte *Data,uint Pos,uint End,byte CmpByte2)
+{
+  const __m128i E8=_mm_set1_epi8((char)0xe8),Cmp2=_mm_set1_epi8((char)CmpByte2);
+  for (;Pos+16<=End;Pos+=16)
+  {
+    __m128i D=_mm_loadu_si128((__m128i *)(Data+Pos));
+    uint Mask=_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(D,E8),_mm_cmpeq_epi8(D,Cmp2)));
+    if (Mask!=0)
+      return Pos+TrailingZeros(Mask);
+  }
+  return FindE8Generic(Data,Pos,End,CmpByte2);
+}
+
+
+SSE_FUNCTION("avx2")
+static uint FindE8_AVX2(const byte *Data,uint Pos,uint End,byte CmpByte2)
+{
+  const __m256i E8=_mm256_set1_epi8((char)0xe8),Cmp2=_mm256_set1_epi8((char)CmpByte2);
+  for (;Pos+32<=End;Pos+=32)
+  {
+    __m256i D=_mm256_loadu_si256((__m256i *)(Data+Pos));
+    uint Mask=_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(D,E8),_mm256_cmpeq_epi8(D,Cmp2)));
+    if (Mask!=0)
+      return Pos+TrailingZeros(Mask);
+  }
+  return FindE8_SSE2(Data,Pos,End,CmpByte2);
+}
+
+
+// Process 4 ARM instructions at once. Return the number of processed bytes.
+SSE_FUNCTION("sse2")
+static uint ArmFilter_SSE2(byte *Data,uint DataSize,uint FileOffset)
+{
+  const __m128i BL=_mm_set1_epi32(0xeb000000),OpMask=_mm_set1_epi32(0xff000000);
+  __m128i Pos=_mm_setr_epi32(FileOffset,FileOffset+4,FileOffset+8,FileOffset+12);
+  uint CurPos=0;
+  for (;CurPos+16<=DataSize;CurPos+=16)
+  {
+    __m128i D=_mm_loadu_si128((__m128i *)(Data+CurPos));
+    __m128i IsBL=_mm_cmpeq_epi32(_mm_and_si128(D,OpMask),BL);
+    if (_mm_movemask_epi8(IsBL)!=0)
+    {
+      // Low 24 bits of difference do not depend on opcode byte.
+      __m128i Addr=_mm_sub_epi32(D,_mm_srli_epi32(Pos,2));
+      Addr=_mm_or_si128(_mm_andnot_si128(OpMask,Addr),BL);
+      D=_mm_or_si128(_mm_and_si128(IsBL,Addr),_mm_andnot_si128(IsBL,D));
+      _mm_storeu_si128((__m128i *)(Data+CurPos),D);
+    }
+    Pos=_mm_add_epi32(Pos,_mm_set1_epi32(16));
+  }
+  return CurPos;
+}
+#endif
+
+
+#ifdef USE_NEON
+static uint FindE8_NEON(const byte *Data,uint Pos,uint End,byte CmpByte2)
+{
+  const uint8x16_t E8=vdupq_n_u8(0xe8),Cmp2=vdupq_n_u8(CmpByte2);
+  for (;Pos+16<=End;Pos+=16)
+  {
+    uint8x16_t D=vld1q_u8(Data+Pos);
+    uint8x16_t Found=vorrq_u8(vceqq_u8(D,E8),vceqq_u8(D,Cmp2));
+    // Narrow comparison result to 4 bits per byte to get a scalar mask.
+    uint64 Mask=vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(Found),4)),0);
+    if (Mask!=0)
+      return Pos+__builtin_ctzll(Mask)/4;
+  }
+  return FindE8Generic(Data,Pos,End,CmpByte2);
+}
+
+
+static uint ArmFilter_NEON(byte *Data,uint DataSize,uint FileOffset)
+{
+  const uint32x4_t BL=vdupq_n_u32(0xeb000000),OpMask=vdupq_n_u32(0xff000000);
+  const uint Start[4]={FileOffset,FileOffset+4,FileOffset+8,FileOffset+12};
+  uint32x4_t Pos=vld1q_u32(Start);
+  uint CurPos=0;
+  for (;CurPos+16<=DataSize;CurPos+=16)
+  {
+    uint32x4_t D=vld1q_u32((uint32_t *)(Data+CurPos));
+    uint32x4_t IsBL=vceqq_u32(vandq_u32(D,OpMask),BL);
+    if (vmaxvq_u32(IsBL)!=0)
+    {
+      uint32x4_t Addr=vsubq_u32(D,vshrq_n_u32(Pos,2));
+      Addr=vorrq_u32(vbicq_u32(Addr,OpMask),BL);
+      vst1q_u32((uint32_t *)(Data+CurPos),vbslq_u32(IsBL,Addr,D));
+    }
+    Pos=vaddq_u32(Pos,vdupq_n_u32(16));
+  }
+  return CurPos;
+}
+#endif
+
+
+static inline uint FindE8(const byte *Data,uint Pos,uint End,byte CmpByte2)
+{
+#if defined(USE_SSE)
+  if (_SSE_Version>=SSE_AVX2)
+    return FindE8_AVX2(Data,Pos,End,CmpByte2);
+  if (_SSE_Version>=SSE_SSE2) // 32-bit MSVC build can run without SSE2.
+    return FindE8_SSE2(Data,Pos,End,CmpByte2);
+  return FindE8Generic(Data,Pos,End,CmpByte2);
+#elif defined(USE_NEON)
+  return FindE8_NEON(Data,Pos,End,CmpByte2);
+#else
+  return FindE8Generic(Data,Pos,End,CmpByte2);
+#endif
+}
+
+
 byte* Unpack::ApplyFilter(byte *Data,uint DataSize,UnpackFilter *Flt)
 {
   byte *SrcData=Data;
@@ -407,40 +565,49 @@ byte* Unpack::ApplyFilter(byte *Data,uint DataSize,UnpackFilter *Flt)
 
         const uint FileSize=0x1000000;
         byte CmpByte2=Flt->Type==FILTER_E8E9 ? 0xe9:0xe8;
-        // DataSize is unsigned, so we use "CurPos+4" and not "DataSize-4"
-        // to avoid overflow for DataSize<4.
-        for (uint CurPos=0;CurPos+4<DataSize;)
+        // DataSize is unsigned, so we check it before subtracting 4.
+        uint End=DataSize>4 ? DataSize-4:0;
+        for (uint CurPos=0;CurPos<End;)
         {
-          byte CurByte=*(Data++);
+          // Most of data are not opcodes, so we use the vectorized search
+          // and process found opcodes one by one.
+          CurPos=FindE8(Data,CurPos,End,CmpByte2);
+          if (CurPos>=End)
+            break;
           CurPos++;
-          if (CurByte==0xe8 || CurByte==CmpByte2)
-          {
-            uint Offset=(CurPos+FileOffset)%FileSize;
-            uint Addr=RawGet4(Data);
+          byte *D=Data+CurPos;
 
-            // We check 0x80000000 bit instead of '< 0' comparison
-            // not assuming int32 presence or uint size and endianness.
-            if ((Addr & 0x80000000)!=0)              // Addr<0
-            {
-              if (((Addr+Offset) & 0x80000000)==0)   // Addr+Offset>=0
-                RawPut4(Addr+FileSize,Data);
-            }
-            else
-              if (((Addr-FileSize) & 0x80000000)!=0) // Addr<FileSize
-                RawPut4(Addr-Offset,Data);
+          uint Offset=(CurPos+FileOffset)%FileSize;
+          uint Addr=RawGet4(D);
 
-            Data+=4;
-            CurPos+=4;
+          // We check 0x80000000 bit instead of '< 0' comparison
+          // not assuming int32 presence or uint size and endianness.
+          if ((Addr & 0x80000000)!=0)              // Addr<0
+          {
+            if (((Addr+Offset) & 0x80000000)==0)   // Addr+Offset>=0
+              RawPut4(Addr+FileSize,D);
           }
+          else
+            if (((Addr-FileSize) & 0x80000000)!=0) // Addr<FileSize
+              RawPut4(Addr-Offset,D);
+
+          CurPos+=4;
         }
       }
       return SrcData;
     case FILTER_ARM:
       {
         uint FileOffset=(uint)WrittenFileSize;
+        uint CurPos=0;
+#if defined(USE_SSE)
+        if (_SSE_Version>=SSE_SSE2)
+          CurPos=ArmFilter_SSE2(Data,DataSize,FileOffset);
+#elif defined(USE_NEON)
+        CurPos=ArmFilter_NEON(Data,DataSize,FileOffset);
+#endif
         // DataSize is unsigned, so we use "CurPos+3" and not "DataSize-3"
         // to avoid overflow for DataSize<3.
-        for (uint CurPos=0;CurPos+3<DataSize;CurPos+=4)
+        for (;CurPos+3<DataSize;CurPos+=4)
         {
           byte *D=Data+CurPos;
           if (D[3]==0xeb) // BL command with '1110' (Always) condition.
@@ -458,19 +625,9 @@ byte* Unpack::ApplyFilter(byte *Data,uint DataSize,UnpackFilter *Flt)
       {
         // Unlike RAR3, we do not need to reject excessive channel
         // values here, since RAR5 uses only 5 bits to store channel.
-        uint Channels=Flt->Channels,SrcPos=0;
-
         FilterDstMemory.Alloc(DataSize);
         byte *DstData=&FilterDstMemory[0];
-
-        // Bytes from same channels are grouped to continual data blocks,
-        // so we need to place them back to their interleaving positions.
-        for (uint CurChannel=0;CurChannel<Channels;CurChannel++)
-        {
-          byte PrevByte=0;
-          for (uint DestPos=CurChannel;DestPos<DataSize;DestPos+=Channels)
-            DstData[DestPos]=(PrevByte-=Data[SrcPos++]);
-        }
+        UnpackDeltaFilter(DstData,Data,DataSize,Flt->Channels);
         return DstData;
       }
 
@@ -499,10 +656,13 @@ void Unpack::UnpWriteArea(size_t StartPtr,size_t EndPtr)
   }
   else
     if (EndPtr<StartPtr)
-    {
-      UnpWriteData(Window+StartPtr,MaxWinSize-StartPtr);
-      UnpWriteData(Window,EndPtr);
-    }
+      if (Mirrored) // Data after the window end mirror the window start.
+        UnpWriteData(Window+StartPtr,MaxWinSize-StartPtr+EndPtr);
+      else
+      {
+        UnpWriteData(Window+StartPtr,MaxWinSize-StartPtr);
+        UnpWriteData(Window,EndPtr);
+      }
     else
       UnpWriteData(Window+StartPtr,EndPtr-StartPtr);
 }
@@ -670,6 +830,7 @@ bool Unpack::ReadTables(BitInput &Inp,UnpackBlockHeader &Header,UnpackBlockTable
   if (!Inp.ExternalBuffer && Inp.InAddr>ReadTop)
     return false;
   MakeDecodeTables(&Table[0],&Tables.LD,NC);
+  MakeLitPairTable(&Tables.LD,Tables.LitPair);
   MakeDecodeTables(&Table[NC],&Tables.DD,DC);
   MakeDecodeTables(&Table[NC+DC],&Tables.LDD,LDC);
   MakeDecodeTables(&Table[NC+DC+LDC],&Tables.RD,RC);
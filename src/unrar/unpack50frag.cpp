@@ -2,6 +2,9 @@ FragmentedWindow::FragmentedWindow()
 {
   memset(Mem,0,sizeof(Mem));
   memset(MemSize,0,sizeof(MemSize));
+#ifdef RAR_TEST_HOOKS
+  MaxBlockSize=0;
+#endif
 }
 
 
@@ -31,6 +34,10 @@ void FragmentedWindow::Init(size_t WinSize)
   while (TotalSize<WinSize && BlockNum<ASIZE(Mem))
   {
     size_t Size=WinSize-TotalSize; // Size needed to allocate.
+#ifdef RAR_TEST_HOOKS
+    if (MaxBlockSize!=0)
+      Size=Min(Size,MaxBlockSize);
+#endif
 
     // Minimum still acceptable block size. Next allocations cannot be larger
     // than current, so we do not need blocks if they are smaller than
@@ -77,6 +84,24 @@ byte& FragmentedWindow::operator [](size_t Item)
 void FragmentedWindow::CopyString(uint Length,uint Distance,size_t &UnpPtr,size_t MaxWinMask)
 {
   size_t SrcPtr=UnpPtr-Distance;
+
+  // Use the fast copy if entire source and destination are in the same
+  // memory block, which is the most common case.
+  if (SrcPtr<UnpPtr)
+    for (uint I=0;I<ASIZE(MemSize);I++)
+      if (UnpPtr<MemSize[I])
+      {
+        size_t BlockStart=I==0 ? 0:MemSize[I-1];
+        if (SrcPtr>=BlockStart && UnpPtr+Length<=MemSize[I] && UnpPtr+Length<=MaxWinMask)
+        {
+          byte *Dest=Mem[I]+UnpPtr-BlockStart;
+          CopyMatchData(Dest,Dest-Distance,Length,Distance);
+          UnpPtr+=Length;
+          return;
+        }
+        break;
+      }
+
   while (Length-- > 0)
   {
     (*this)[UnpPtr]=(*this)[SrcPtr++ & MaxWinMask];
@@ -1,6 +1,22 @@
 #define UNP_READ_SIZE_MT        0x400000
 #define UNP_BLOCKS_PER_THREAD          2
 
+// Read buffer grows up to this size if it cannot fit enough blocks
+// to load all threads. It is enough for 64 threads and 128 KB blocks.
+// Read ahead buffer does not exceed it too, limiting memory per archive.
+#define UNP_READ_SIZE_MT_MAX   0x1000000
+
+// Even getbits32 can read up to 3 additional bytes after current
+// and our block header and table reading code can look much further.
+// Let's allocate the additional space here, so we do not need to check
+// bounds for every bit field access.
+#define UNP_READ_OVERFLOW_MT        1024
+
+// I/O thread reads data after this gap in buffer beginning. Before swapping
+// buffers we copy the not processed data to the gap, so it precedes
+// the read data. It is larger than typical incomplete block.
+#define UNP_READ_GAP_MT          0x40000
+
 
 struct UnpackThreadDataList
 {
@@ -17,19 +33,25 @@ THREAD_PROC(UnpackDecodeThread)
 }
 
 
+THREAD_PROC(ProcessDecodedThread)
+{
+  UnpackThreadData *D=(UnpackThreadData *)Data;
+  D->UnpackPtr->ProcessDecodedMT(*D);
+}
+
+
 void Unpack::InitMT()
 {
-  if (ReadBufMT==NULL)
+  if (ReadBufMTMem==NULL)
   {
-    // Even getbits32 can read up to 3 additional bytes after current
-    // and our block header and table reading code can look much further.
-    // Let's allocate the additional space here, so we do not need to check
-    // bounds for every bit field access.
-    const size_t Overflow=1024;
-
-    ReadBufMT=new byte[UNP_READ_SIZE_MT+Overflow];
-    memset(ReadBufMT,0,UNP_READ_SIZE_MT+Overflow);
+    ReadBufMTSize=UNP_READ_SIZE_MT;
+    size_t AllocSize=ReadBufMTSize+UNP_READ_GAP_MT+UNP_READ_OVERFLOW_MT;
+    ReadBufMTMem=(byte *)MemPoolAlloc(AllocSize);
+    if (ReadBufMTMem==NULL)
+      ErrHandler.MemoryError();
+    memset(ReadBufMTMem,0,AllocSize);
   }
+  ReadBufMT=ReadBufMTMem;
   if (UnpThreadData==NULL)
   {
     uint MaxItems=MaxUserThreads*UNP_BLOCKS_PER_THREAD;
@@ -44,7 +66,7 @@ void Unpack::InitMT()
         // Typical number of items in RAR blocks does not exceed 0x4000.
         CurData->DecodedAllocated=0x4100;
         // It will be freed in the object destructor, not in this file.
-        CurData->Decoded=(UnpackDecodedItem *)malloc(CurData->DecodedAllocated*sizeof(UnpackDecodedItem));
+        CurData->Decoded=(UnpackDecodedItem *)MemPoolAlloc(CurData->DecodedAllocated*sizeof(UnpackDecodedItem));
         if (CurData->Decoded==NULL)
           ErrHandler.MemoryError();
       }
@@ -53,12 +75,178 @@ void Unpack::InitMT()
 }
 
 
+// Move DataSize bytes of not processed data to NewBuf.
+void Unpack::MoveReadBufMT(byte *NewBuf,int DataSize)
+{
+  memcpy(NewBuf,ReadBufMT,DataSize);
+
+  // Incomplete block, which will be continued after reading, refers
+  // to data in the beginning of buffer.
+  for (uint I=0;I<MaxUserThreads*UNP_BLOCKS_PER_THREAD;I++)
+  {
+    BitInput &Inp=UnpThreadData[I].Inp;
+    if (UnpThreadData[I].Incomplete)
+      Inp.InBuf=NewBuf+(Inp.InBuf-ReadBufMT);
+  }
+  ReadBufMT=NewBuf;
+}
+
+
+// Enlarge the read buffer preserving DataSize bytes in its beginning.
+void Unpack::GrowReadBufMT(int NewSize,int DataSize)
+{
+  size_t AllocSize=NewSize+UNP_READ_GAP_MT+UNP_READ_OVERFLOW_MT;
+  byte *NewBuf=(byte *)MemPoolAlloc(AllocSize);
+  if (NewBuf==NULL)
+    ErrHandler.MemoryError();
+  memset(NewBuf+DataSize,0,AllocSize-DataSize);
+  MoveReadBufMT(NewBuf,DataSize);
+
+  MemPoolFree(ReadBufMTMem,ReadBufMTSize+UNP_READ_GAP_MT+UNP_READ_OVERFLOW_MT);
+  ReadBufMTMem=NewBuf;
+  ReadBufMTSize=NewSize;
+}
+
+
+THREAD_PROC(UnpackReadThread)
+{
+  ((Unpack *)Data)->ReadAheadMT();
+}
+
+
+// Read the next portion of packed data in I/O thread.
+void Unpack::ReadAheadMT()
+{
+  ReadAheadResult=UnpIO->UnpReadAhead(ReadAheadBuf+UNP_READ_GAP_MT,ReadAheadCount);
+}
+
+
+// Start reading the next portion of packed data in I/O thread, so it is
+// ready when we process the current data.
+void Unpack::StartReadAheadMT()
+{
+#ifdef USE_THREADS
+  if (ReadAheadActive)
+    return;
+
+  // Read ahead buffer replaces the read buffer, so it has the same size.
+  // But it does not follow the read buffer grown above the usual limit
+  // to fit an unusually large block.
+  int NeedSize=Min(ReadBufMTSize,UNP_READ_SIZE_MT_MAX);
+  if (ReadAheadBufSize<NeedSize)
+  {
+    MemPoolFree(ReadAheadBuf,ReadAheadBufSize+UNP_READ_GAP_MT+UNP_READ_OVERFLOW_MT);
+    ReadAheadBufSize=NeedSize;
+    size_t AllocSize=ReadAheadBufSize+UNP_READ_GAP_MT+UNP_READ_OVERFLOW_MT;
+    ReadAheadBuf=(byte *)MemPoolAlloc(AllocSize);
+    if (ReadAheadBuf==NULL)
+      ErrHandler.MemoryError();
+    memset(ReadAheadBuf,0,AllocSize);
+  }
+
+  // Do not switch volumes in I/O thread. It can require the user
+  // interaction, so we let the main thread to do it in UnpRead call.
+  int64 Count=Min((int64)ReadAheadBufSize,UnpIO->GetPackedSizeToRead());
+  Count&=~0xf;
+  if (Count==0)
+    return;
+
+  ReadAheadCount=(int)Count;
+  ReadAheadActive=true;
+  ReadAheadThread->AddTask(UnpackReadThread,(void*)this);
+#endif
+}
+
+
+// Return the size of data read in I/O thread or -1 if there is no data.
+int Unpack::WaitReadAheadMT()
+{
+  if (!ReadAheadActive)
+    return -1;
+  ReadAheadThread->WaitDone();
+  ReadAheadActive=false;
+  return ReadAheadResult;
+}
+
+
+// Read data after DataSize bytes of not processed data in ReadBufMT.
+// Get the data read in I/O thread or read it in current thread
+// if no data is available. Start reading the next portion after that.
+int Unpack::UnpReadMT(int DataSize)
+{
+  int ReadSize=WaitReadAheadMT();
+  if (ReadSize>0)
+  {
+    byte *ReadData=ReadAheadBuf+UNP_READ_GAP_MT;
+    if (DataSize<=UNP_READ_GAP_MT)
+    {
+      // Put not processed data before the read data and swap buffers.
+      MoveReadBufMT(ReadData-DataSize,DataSize);
+      byte *Mem=ReadBufMTMem;
+      int MemSize=ReadBufMTSize;
+      ReadBufMTMem=ReadAheadBuf;
+      ReadBufMTSize=ReadAheadBufSize;
+      ReadAheadBuf=Mem;
+      ReadAheadBufSize=MemSize;
+    }
+    else
+    {
+      // Not processed data does not fit the gap. It can happen only
+      // for unusually large blocks, so we simply copy the read data.
+      if (ReadBufMTMem+ReadBufMTSize+UNP_READ_GAP_MT-ReadBufMT<DataSize+ReadSize)
+        GrowReadBufMT(DataSize+ReadSize,DataSize);
+      memcpy(ReadBufMT+DataSize,ReadData,ReadSize);
+    }
+    ReadSize=UnpIO->UnpReadAheadDone(ReadBufMT+DataSize,ReadSize);
+  }
+  else
+  {
+    int FreeSize=int(ReadBufMTMem+ReadBufMTSize+UNP_READ_GAP_MT-ReadBufMT)-DataSize;
+    ReadSize=UnpIO->UnpRead(ReadBufMT+DataSize,FreeSize&~0xf);
+  }
+  if (ReadSize>0)
+    StartReadAheadMT();
+  return ReadSize;
+}
+
+
+// Wait for I/O thread. Data read in advance is not needed anymore,
+// but we pass it to ComprDataIO as read unless we process an exception,
+// so packed data hash and progress include it same as in usual reading.
+void Unpack::StopReadAheadMT(bool Discard)
+{
+  int ReadSize=WaitReadAheadMT();
+  if (ReadSize>0 && !Discard)
+    UnpIO->UnpReadAheadDone(ReadAheadBuf+UNP_READ_GAP_MT,ReadSize);
+}
+
+
 void Unpack::Unpack5MT(bool Solid)
+{
+  try
+  {
+    Unpack5MTLoop(Solid);
+  }
+  catch (...)
+  {
+    // Stop I/O thread before passing the exception to caller,
+    // which can close the archive file.
+    StopReadAheadMT(true);
+    throw;
+  }
+
+  // I/O thread can still read data after the end of damaged file.
+  StopReadAheadMT(false);
+}
+
+
+void Unpack::Unpack5MTLoop(bool Solid)
 {
   InitMT();
   UnpInitData(Solid);
 
-  for (uint I=0;I<MaxUserThreads*UNP_BLOCKS_PER_THREAD;I++)
+  const uint MaxBlocks=MaxUserThreads*UNP_BLOCKS_PER_THREAD;
+  for (uint I=0;I<MaxBlocks;I++)
   {
     UnpackThreadData *CurData=UnpThreadData+I;
     CurData->LargeBlock=false;
@@ -72,12 +260,16 @@ void Unpack::Unpack5MT(bool Solid)
   int DataSize=0;
   int BlockStart=0;
 
+  // Read buffer size, which is large enough to fit blocks for all threads.
+  int NeedReadSize=ReadBufMTSize;
 
   // 'true' if we found a block too large for multithreaded extraction,
   // so we switched to single threaded mode until the end of file.
   // Large blocks could cause too high memory use in multithreaded mode.
   bool LargeBlock=false;
 
+  SingleLZMT=false;
+
   bool Done=false;
   while (!Done)
   {
@@ -85,7 +277,10 @@ void Unpack::Unpack5MT(bool Solid)
     // so we can safely read them without additional checks.
     const int TooSmallToProcess=1024;
 
-    int ReadSize=UnpIO->UnpRead(ReadBufMT+DataSize,(UNP_READ_SIZE_MT-DataSize)&~0xf);
+    if (NeedReadSize>ReadBufMTSize)
+      GrowReadBufMT(NeedReadSize,DataSize);
+
+    int ReadSize=UnpReadMT(DataSize);
     if (ReadSize<0)
       break;
     DataSize+=ReadSize;
@@ -100,7 +295,8 @@ void Unpack::Unpack5MT(bool Solid)
     while (BlockStart<DataSize && !Done)
     {
       uint BlockNumber=0,BlockNumberMT=0;
-      while (BlockNumber<MaxUserThreads*UNP_BLOCKS_PER_THREAD)
+      int BatchStart=BlockStart;
+      while (BlockNumber<MaxBlocks)
       {
         UnpackThreadData *CurData=UnpThreadData+BlockNumber;
         LastBlockNum=BlockNumber;
@@ -195,17 +391,35 @@ void Unpack::Unpack5MT(bool Solid)
       if (BlockNumber==0)
         break;
 
+      // If buffer ended before we collected blocks for all threads,
+      // increase the next read size to fit them, so more threads can work
+      // in parallel. It is important if we have many threads.
+      if (BlockNumberMT>0 && BlockNumberMT<MaxBlocks && !LargeBlock)
+      {
+        int64 AverageBlock=(BlockStart-BatchStart)/BlockNumberMT;
+        int64 NeedSize=AverageBlock*(MaxBlocks+1)+TooSmallToProcess;
+        NeedSize=Min(NeedSize,UNP_READ_SIZE_MT_MAX);
+        if (NeedSize>NeedReadSize)
+          NeedReadSize=(int)NeedSize;
+      }
+
 #ifdef USE_THREADS
       UnpThreadPool->WaitDone();
 #endif
 
       bool IncompleteThread=false;
       
-      for (uint Block=0;Block<BlockNumber;Block++)
+      // Blocks already processed by multithreaded LZ code.
+      uint ProcessedMT=0;
+      if (BlockNumber>1 && !SingleLZMT && !ProcessDecodedBlocks(BlockNumber,ProcessedMT))
+        Done=true;
+
+      for (uint Block=0;Block<BlockNumber && !Done;Block++)
       {
         UnpackThreadData *CurData=UnpThreadData+Block;
-        if (!CurData->LargeBlock && !ProcessDecoded(*CurData) ||
-            CurData->LargeBlock && !UnpackLargeBlock(*CurData) ||
+        bool Processed=Block<ProcessedMT;
+        if ((!Processed && !CurData->LargeBlock && !ProcessDecoded(*CurData)) ||
+            (!Processed && CurData->LargeBlock && !UnpackLargeBlock(*CurData)) ||
             CurData->DamagedData)
         {
           Done=true;
@@ -234,9 +448,13 @@ void Unpack::Unpack5MT(bool Solid)
             // buffer for decoded data.
             UnpackDecodedItem *Decoded=UnpThreadData[0].Decoded;
             uint DecodedAllocated=UnpThreadData[0].DecodedAllocated;
+            UnpackDeferredItem *Deferred=UnpThreadData[0].Deferred;
+            uint DeferredAllocated=UnpThreadData[0].DeferredAllocated;
             UnpThreadData[0]=*CurData;
             UnpThreadData[0].Decoded=Decoded;
             UnpThreadData[0].DecodedAllocated=DecodedAllocated;
+            UnpThreadData[0].Deferred=Deferred;
+            UnpThreadData[0].DeferredAllocated=DeferredAllocated;
             CurData->Incomplete=false;
           }
 
@@ -330,11 +548,41 @@ void Unpack::UnpackDecode(UnpackThreadData &D)
     }
     if (D.DecodedSize>D.DecodedAllocated-8) // Filter can use several slots.
     {
-      D.DecodedAllocated=D.DecodedAllocated*2;
-      void *Decoded=realloc(D.Decoded,D.DecodedAllocated*sizeof(UnpackDecodedItem));
+      uint NewAllocated=D.DecodedAllocated*2;
+      void *Decoded=realloc(D.Decoded,NewAllocated*sizeof(UnpackDecodedItem));
       if (Decoded==NULL)
         ErrHandler.MemoryError(); // D.Decoded will be freed in the destructor.
       D.Decoded=(UnpackDecodedItem *)Decoded;
+      // Set after successful realloc, because destructor returns Decoded
+      // of DecodedAllocated size to memory pool.
+      D.DecodedAllocated=NewAllocated;
+    }
+
+    // Decode two literals at once if we are far enough from block end,
+    // so the second literal is not read beyond it.
+    if (D.Inp.InAddr<ReadBorder-2)
+    {
+      uint LitPair=D.BlockTables.LitPair[D.Inp.getbits()>>(16-QUICK_PAIR_BITS)];
+      if (LitPair!=0)
+      {
+        D.Inp.addbits(LitPair>>16);
+        UnpackDecodedItem *PrevItem=D.DecodedSize>0 ? D.Decoded+D.DecodedSize-1:NULL;
+        if (PrevItem!=NULL && PrevItem->Type==UNPDT_LITERAL && PrevItem->Length<2)
+        {
+          PrevItem->Literal[PrevItem->Length+1]=(byte)LitPair;
+          PrevItem->Literal[PrevItem->Length+2]=(byte)(LitPair>>8);
+          PrevItem->Length+=2;
+        }
+        else
+        {
+          UnpackDecodedItem *CurItem=D.Decoded+D.DecodedSize++;
+          CurItem->Type=UNPDT_LITERAL;
+          CurItem->Literal[0]=(byte)LitPair;
+          CurItem->Literal[1]=(byte)(LitPair>>8);
+          CurItem->Length=1;
+        }
+        continue;
+      }
     }
 
     UnpackDecodedItem *CurItem=D.Decoded+D.DecodedSize++;
@@ -515,6 +763,327 @@ bool Unpack::ProcessDecoded(UnpackThreadData &D)
 }
 
 
+// Thread safe version of CopyString, which does not modify UnpPtr.
+static inline void CopyStringMT(byte *Window,size_t MaxWinSize,size_t MaxWinMask,
+                                bool Mirrored,size_t DestPtr,uint Length,uint Distance)
+{
+  if (Mirrored)
+    CopyMatchData(Window+DestPtr,Window+((DestPtr-Distance) & MaxWinMask),
+                  Length,uint(Distance & MaxWinMask));
+  else
+    if (Distance<=DestPtr && DestPtr<MaxWinSize-PackDef::MAX_INC_LZ_MATCH)
+      CopyMatchData(Window+DestPtr,Window+DestPtr-Distance,Length,Distance);
+    else
+    {
+      size_t SrcPtr=(DestPtr-Distance) & MaxWinMask;
+      while (Length-- > 0)
+      {
+        Window[DestPtr]=Window[SrcPtr++ & MaxWinMask];
+        DestPtr=(DestPtr+1) & MaxWinMask;
+      }
+    }
+}
+
+
+// Calculate the output size of decoded block and the lowest position
+// referenced by its matches. If Commit is true, also replace repeated
+// distances with actual values, update the distance history and add
+// filters, so block items can be processed independently from other blocks.
+// UnpPtr must point to beginning of block output.
+void Unpack::ResolveDecoded(UnpackThreadData &D,bool Commit)
+{
+  uint Dist[4];
+  for (uint I=0;I<ASIZE(Dist);I++)
+    Dist[I]=OldDist[I];
+  uint LastLen=LastLength;
+
+  size_t StartPtr=UnpPtr;
+  uint Offset=0,FilterCount=0;
+  int64 MinSrc=0;
+
+  UnpackDecodedItem *Item=D.Decoded,*Border=D.Decoded+D.DecodedSize;
+  for (;Item<Border;Item++)
+  {
+    if (Item->Type==UNPDT_LITERAL)
+    {
+      Offset+=Item->Length+1;
+      continue;
+    }
+    if (Item->Type==UNPDT_FILTER)
+    {
+      FilterCount++;
+      if (Commit)
+      {
+        UnpackFilter Filter;
+        Filter.Type=(byte)Item->Length;
+        Filter.BlockStart=Item->Distance;
+        Filter.Channels=(byte)Item[1].Length;
+        Filter.BlockLength=Item[1].Distance;
+
+        UnpPtr=(StartPtr+Offset) & MaxWinMask;
+        AddFilter(Filter);
+      }
+      Item++;
+      continue;
+    }
+
+    uint Length,Distance;
+    if (Item->Type==UNPDT_MATCH)
+    {
+      Length=LastLen=Item->Length;
+      Distance=Item->Distance;
+      Dist[3]=Dist[2];
+      Dist[2]=Dist[1];
+      Dist[1]=Dist[0];
+      Dist[0]=Distance;
+    }
+    else
+      if (Item->Type==UNPDT_REP)
+      {
+        Length=LastLen=Item->Length;
+        Distance=Dist[Item->Distance];
+        for (uint I=Item->Distance;I>0;I--)
+          Dist[I]=Dist[I-1];
+        Dist[0]=Distance;
+      }
+      else // UNPDT_FULLREP.
+      {
+        Length=LastLen;
+        Distance=Dist[0];
+      }
+
+    if (Commit)
+    {
+      Item->Type=UNPDT_MATCH;
+      Item->Length=(ushort)Length;
+      Item->Distance=Distance;
+    }
+    if (Length>0)
+      MinSrc=Min(MinSrc,(int64)Offset-Distance);
+    Offset+=Length;
+  }
+
+  D.OutSize=Offset;
+  D.MinSrc=MinSrc;
+  D.FilterCount=FilterCount;
+  if (Commit)
+  {
+    for (uint I=0;I<ASIZE(Dist);I++)
+      OldDist[I]=Dist[I];
+    LastLength=LastLen;
+    UnpPtr=(StartPtr+Offset) & MaxWinMask;
+  }
+}
+
+
+// Check if Start..End block data range overlaps output of deferred items.
+static bool IsDeferredData(UnpackDeferredItem *Items,uint Count,int64 Start,int64 End)
+{
+  if (Count==0 || Start>=End)
+    return false;
+  UnpackDeferredItem *Last=Items+Count-1;
+  if (Last->Dest+Last->Length<=Start) // Most common case.
+    return false;
+
+  // Deferred items are sorted and do not overlap, so we search for last
+  // item starting before End and check if it ends after Start.
+  uint Low=0,High=Count;
+  while (High-Low>1)
+  {
+    uint Middle=(Low+High)/2;
+    if (Items[Middle].Dest<End)
+      Low=Middle;
+    else
+      High=Middle;
+  }
+  return Items[Low].Dest<End && Items[Low].Dest+Items[Low].Length>Start;
+}
+
+
+// Process decoded items of resolved block in parallel with other blocks
+// of segment. Preceding blocks of segment are processed simultaneously,
+// so matches referencing their data or data of already deferred matches
+// are stored to deferred list to process them later in single thread.
+// Data preceding the segment is always available.
+void Unpack::ProcessDecodedMT(UnpackThreadData &D)
+{
+  UnpackDeferredItem *Own=D.Deferred;
+  uint OwnCount=0;
+  uint Offset=0,DeferredData=0;
+
+  UnpackDecodedItem *Item=D.Decoded,*Border=D.Decoded+D.DecodedSize;
+  for (;Item<Border;Item++)
+  {
+    size_t DestPtr=(D.WinStart+Offset) & MaxWinMask;
+    if (Item->Type==UNPDT_LITERAL)
+    {
+#if defined(LITTLE_ENDIAN) && defined(ALLOW_MISALIGNED)
+      if (Item->Length==3 && DestPtr<MaxWinSize-4)
+        *(uint32 *)(Window+DestPtr)=*(uint32 *)Item->Literal;
+      else
+#endif
+        for (uint I=0;I<=Item->Length;I++)
+          Window[(DestPtr+I) & MaxWinMask]=Item->Literal[I];
+      Offset+=Item->Length+1;
+    }
+    else
+      if (Item->Type==UNPDT_FILTER)
+        Item++; // Filters are added by ResolveDecoded.
+      else // Only UNPDT_MATCH is possible in resolved block.
+      {
+        uint Length=Item->Length,Distance=Item->Distance;
+        int64 From=(int64)Offset-Distance,To=From+Length;
+        if ((D.SegStart>0 && From<0 && To>-(int64)D.SegStart) || // Preceding blocks.
+            (To>0 && IsDeferredData(Own,OwnCount,Max(From,0),To)))
+        {
+          UnpackDeferredItem *Deferred=Own+OwnCount++;
+          Deferred->Dest=Offset;
+          Deferred->Length=Length;
+          Deferred->Distance=Distance;
+          DeferredData+=Length;
+        }
+        else
+          CopyStringMT(Window,MaxWinSize,MaxWinMask,Mirrored,DestPtr,Length,Distance);
+        Offset+=Length;
+      }
+  }
+  D.DeferredSize=OwnCount;
+  D.DeferredData=DeferredData;
+}
+
+
+// Process decoded blocks in parallel. We split blocks to segments fitting
+// to the write buffer. For every segment we serially resolve repeated
+// distances and filters, process blocks in parallel deferring matches,
+// which depend on data of other blocks, and then process deferred matches
+// in single thread in the order of their appearance.
+// Stops before large, damaged or incomplete block and returns the number
+// of processed blocks in Processed.
+bool Unpack::ProcessDecodedBlocks(uint BlockCount,uint &Processed)
+{
+  Processed=0;
+  bool Flushed=false;
+  while (Processed<BlockCount)
+  {
+    size_t Space=WriteBorder==UnpPtr ? MaxWinSize:(WriteBorder-UnpPtr) & MaxWinMask;
+    size_t SegLimit=Space>MAX_INC_LZ_MATCH ? Space-MAX_INC_LZ_MATCH:0;
+    size_t SegSize=0;
+    int64 SegMinSrc=0;
+
+    uint First=Processed,Last=Processed;
+    bool Stop=false; // Found a block, which we cannot process here.
+    for (;Last<BlockCount;Last++)
+    {
+      UnpackThreadData *D=UnpThreadData+Last;
+      if (D->LargeBlock || D->Incomplete || D->DamagedData)
+      {
+        Stop=true;
+        break;
+      }
+      ResolveDecoded(*D,false);
+
+      // Segment must fit the write buffer. Also the following blocks
+      // must not overwrite the old window data referenced by matches
+      // in preceding blocks, because we process blocks simultaneously.
+      size_t NewSize=SegSize+D->OutSize;
+      int64 MinSrc=Min(SegMinSrc,(int64)SegSize+D->MinSrc);
+      if (NewSize>SegLimit || (Last>First && (int64)NewSize>MinSrc+(int64)MaxWinSize) ||
+          Filters.Size()+D->FilterCount>=MAX_UNPACK_FILTERS)
+        break;
+
+      if (D->DeferredAllocated<D->DecodedSize)
+      {
+        D->DeferredAllocated=D->DecodedAllocated;
+        size_t AllocSize=D->DeferredAllocated*sizeof(UnpackDeferredItem);
+        void *Deferred=realloc(D->Deferred,AllocSize);
+        if (Deferred==NULL)
+          ErrHandler.MemoryError(); // D->Deferred will be freed in the destructor.
+        D->Deferred=(UnpackDeferredItem *)Deferred;
+      }
+      D->WinStart=UnpPtr;
+      D->SegStart=(uint)SegSize;
+      ResolveDecoded(*D,true);
+
+      SegSize=NewSize;
+      SegMinSrc=MinSrc;
+    }
+
+    if (Last==First)
+    {
+      if (Stop)
+        break;
+      if (!Flushed)
+      {
+        // Write the buffer and try again.
+        UnpWriteBuf();
+        if (WrittenFileSize>DestUnpSize)
+          return false;
+        Flushed=true;
+        continue;
+      }
+      // Block is too large even for empty buffer.
+      if (!ProcessDecoded(UnpThreadData[First]))
+        return false;
+      Processed++;
+      Flushed=false;
+      continue;
+    }
+
+    // The first block of segment never has deferred matches,
+    // so we do not need threads for single block segment.
+    for (uint I=First;I<Last;I++)
+    {
+      UnpackThreadData *D=UnpThreadData+I;
+#ifdef USE_THREADS
+      if (Last-First>1)
+        UnpThreadPool->AddTask(ProcessDecodedThread,(void*)D);
+      else
+#endif
+        ProcessDecodedMT(*D);
+    }
+#ifdef USE_THREADS
+    if (Last-First>1)
+      UnpThreadPool->WaitDone();
+#endif
+
+    // Deferred matches reference only data of current segment or data
+    // preceding it, so processing them in order produces correct output.
+    size_t DeferredData=0;
+    for (uint I=First;I<Last;I++)
+    {
+      UnpackThreadData *D=UnpThreadData+I;
+      for (uint J=0;J<D->DeferredSize;J++)
+      {
+        UnpackDeferredItem *Item=D->Deferred+J;
+        size_t DestPtr=(D->WinStart+Item->Dest) & MaxWinMask;
+        CopyStringMT(Window,MaxWinSize,MaxWinMask,Mirrored,DestPtr,Item->Length,Item->Distance);
+      }
+      DeferredData+=D->DeferredData;
+    }
+
+    // If most of data depends on preceding blocks, single threaded
+    // processing of deferred matches takes almost as much time as processing
+    // the entire segment, so we switch to single threaded mode
+    // until the end of file.
+    if (DeferredData>SegSize/2)
+      SingleLZMT=true;
+
+    Processed=Last;
+    Flushed=false;
+
+    if (Last<BlockCount && !Stop)
+    {
+      // Next block does not fit the rest of buffer.
+      UnpWriteBuf();
+      if (WrittenFileSize>DestUnpSize)
+        return false;
+      Flushed=true;
+    }
+  }
+  return true;
+}
+
+
 // For large blocks we decode and process in same function in single threaded
 // mode, so we do not need to store intermediate data in memory.
 bool Unpack::UnpackLargeBlock(UnpackThreadData &D)
@@ -6,67 +6,107 @@ _forceinline void Unpack::InsertOldDist(uint Distance)
   OldDist[0]=Distance;
 }
 
-#ifdef _MSC_VER
-#define FAST_MEMCPY
-#endif
+// Copy LZ match data from Src to Dest. Src is Dest-Distance or its mirror
+// in mirrored window. Both source and destination must be continuous
+// memory areas. We copy by 16 or 8 bytes if distance
+// permits it. Data of overlapping short distance match repeats with
+// Distance period, so we copy first bytes of such match one by one and then
+// use a multiple of period not less than 8 as distance. We never write
+// beyond Dest+Length, because data after the end of match still can be
+// referenced by following matches.
+static _forceinline void CopyMatchData(byte *Dest,const byte *Src,uint Length,uint Distance)
+{
+  if (Distance<8)
+  {
+    // Zero distance is possible in corrupt archive only.
+    if (Length<16 || Distance==0)
+    {
+      while (Length-- > 0)
+        *(Dest++)=*(Src++);
+      return;
+    }
+    uint Step=Distance;
+    while (Step<8)
+      Step+=Distance;
+    for (uint I=0;I<Step;I++)
+      Dest[I]=Src[I];
+    Dest+=Step;
+    Length-=Step;
+    Src+=Distance; // Now Src data is the same as Step bytes before Dest.
+  }
+  else
+    if (Distance>=16)
+      while (Length>=16)
+      {
+        // Fixed size memcpy is expanded inline to single load and store
+        // by modern compilers.
+        memcpy(Dest,Src,16);
+        Src+=16;
+        Dest+=16;
+        Length-=16;
+      }
+
+  while (Length>=8)
+  {
+    memcpy(Dest,Src,8);
+    Src+=8;
+    Dest+=8;
+    Length-=8;
+  }
+
+  // Unroll the loop for 0 - 7 bytes left. Note that we use nested "if"s.
+  if (Length>0) { Dest[0]=Src[0];
+  if (Length>1) { Dest[1]=Src[1];
+  if (Length>2) { Dest[2]=Src[2];
+  if (Length>3) { Dest[3]=Src[3];
+  if (Length>4) { Dest[4]=Src[4];
+  if (Length>5) { Dest[5]=Src[5];
+  if (Length>6) { Dest[6]=Src[6]; } } } } } } } // Close all nested "if"s.
+}
+
 
 _forceinline void Unpack::CopyString(uint Length,uint Distance)
 {
+  if (Mirrored)
+    CopyString<UNPWIN_MIRRORED>(Length,Distance);
+  else
+    CopyString<UNPWIN_NORMAL>(Length,Distance);
+}
+
+
+template <UNPACK_WINDOW_TYPE WinType> _forceinline void Unpack::CopyString(uint Length,uint Distance)
+{
+#ifdef RAR_TEST_HOOKS
+  if (WinType==UNPWIN_GENERIC)
+  {
+    if (Fragmented)
+      CopyString<UNPWIN_FRAGMENTED>(Length,Distance);
+    else
+      CopyString(Length,Distance);
+    return;
+  }
+#endif
+  if (WinType==UNPWIN_FRAGMENTED)
+  {
+    FragWindow.CopyString(Length,Distance,UnpPtr,MaxWinMask);
+    return;
+  }
+  if (WinType==UNPWIN_MIRRORED)
+  {
+    // Source and destination can cross the window end in mirrored window,
+    // so we need to mask only their start positions.
+    size_t SrcPtr=(UnpPtr-Distance) & MaxWinMask;
+    CopyMatchData(Window+UnpPtr,Window+SrcPtr,Length,uint(Distance & MaxWinMask));
+    UnpPtr=(UnpPtr+Length) & MaxWinMask;
+    return;
+  }
   size_t SrcPtr=UnpPtr-Distance;
   if (SrcPtr<MaxWinSize-MAX_INC_LZ_MATCH && UnpPtr<MaxWinSize-MAX_INC_LZ_MATCH)
   {
     // If we are not close to end of window, we do not need to waste time
     // to "& MaxWinMask" pointer protection.
-
-    byte *Src=Window+SrcPtr;
-    byte *Dest=Window+UnpPtr;
+    CopyMatchData(Window+UnpPtr,Window+SrcPtr,Length,Distance);
     UnpPtr+=Length;
-
-#ifdef FAST_MEMCPY
-    if (Distance<Length) // Overlapping strings
-#endif
-      while (Length>=8)
-      {
-        Dest[0]=Src[0];
-        Dest[1]=Src[1];
-        Dest[2]=Src[2];
-        Dest[3]=Src[3];
-        Dest[4]=Src[4];
-        Dest[5]=Src[5];
-        Dest[6]=Src[6];
-        Dest[7]=Src[7];
-
-        Src+=8;
-        Dest+=8;
-        Length-=8;
-      }
-#ifdef FAST_MEMCPY
-    else
-      while (Length>=8)
-      {
-        // In theory we still could overlap here.
-        // Supposing Distance == MaxWinSize - 1 we have memcpy(Src, Src + 1, 8).
-        // But for real RAR archives Distance <= MaxWinSize - MAX_INC_LZ_MATCH
-        // always, so overlap here is impossible.
-
-        // This memcpy expanded inline by MSVC. We could also use uint64
-        // assignment, which seems to provide about the same speed.
-        memcpy(Dest,Src,8); 
-
-        Src+=8;
-        Dest+=8;
-        Length-=8;
-      }
-#endif
-
-    // Unroll the loop for 0 - 7 bytes left. Note that we use nested "if"s.
-    if (Length>0) { Dest[0]=Src[0];
-    if (Length>1) { Dest[1]=Src[1];
-    if (Length>2) { Dest[2]=Src[2];
-    if (Length>3) { Dest[3]=Src[3];
-    if (Length>4) { Dest[4]=Src[4];
-    if (Length>5) { Dest[5]=Src[5];
-    if (Length>6) { Dest[6]=Src[6]; } } } } } } } // Close all nested "if"s.
   }
   else
     while (Length-- > 0) // Slow copying with all possible precautions.
@@ -91,14 +131,13 @@ _forceinline uint Unpack::DecodeNumber(BitInput &Inp,DecodeTable *Dec)
     return Dec->QuickNum[Code];
   }
 
-  // Detect the real bit length for current code.
-  uint Bits=15;
+  // Detect the real bit length for current code. DecodeLen values are
+  // sorted, so we can count upper limits not exceeding the bit field
+  // instead of searching for the first larger one. It avoids
+  // unpredictable branches.
+  uint Bits=Dec->QuickBits+1;
   for (uint I=Dec->QuickBits+1;I<15;I++)
-    if (BitField<Dec->DecodeLen[I])
-    {
-      Bits=I;
-      break;
-    }
+    Bits+=BitField>=Dec->DecodeLen[I];
 
   Inp.addbits(Bits);
   
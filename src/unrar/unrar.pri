@@ -42,7 +42,10 @@ SOURCES += \
     $$PWD/unpack.cpp \
     $$PWD/headers.cpp \
     $$PWD/threadpool.cpp \
+    $$PWD/mempool.cpp \
+    $$PWD/rs.cpp \
     $$PWD/rs16.cpp \
+    $$PWD/recvol.cpp \
     $$PWD/cmddata.cpp \
     $$PWD/ui.cpp \
     $$PWD/filestr.cpp \
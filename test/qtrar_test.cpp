@@ -1,7 +1,12 @@
 #include <QTest>
+#include <QDir>
 #include <QFile>
+#include <QSemaphore>
+#include <QTemporaryDir>
+#include <QThreadPool>
 
 #include "../src/qtrar.h"
+#include "../src/qtrarfile.h"
 #include "../src/qtrarfileinfo.h"
 
 class TestQtRAR : public QObject
@@ -30,6 +35,13 @@ private slots:
     void fileInfoList_data();
     void password();
     void password_data();
+    void threadPool();
+    void memoryPool();
+    void benchmarkMaxThreadCount();
+    void benchmarkMaxThreadCount_data();
+    void repairVolumes();
+    void repairLegacyVolumes();
+    void verify();
 };
 
 Q_DECLARE_METATYPE(QtRAR::OpenMode)
@@ -465,5 +477,252 @@ void TestQtRAR::password_data()
         << (QStringList());
 }
 
+void TestQtRAR::threadPool()
+{
+    QCOMPARE(QtRAR::threadPool(), (QThreadPool *)0);
+    QVERIFY(QtRAR::maxThreadCount() >= 1);
+
+    QThreadPool pool;
+    QVERIFY(QtRAR::setThreadPool(&pool));
+    QCOMPARE(QtRAR::threadPool(), &pool);
+
+    QtRARFile f("assets/multiple.rar", "qt.txt");
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QCOMPARE(f.readAll(), QByteArray("rar\n"));
+
+    // Workers of open archive may still use the pool
+    QVERIFY(!QtRAR::setThreadPool(0));
+    QCOMPARE(QtRAR::threadPool(), &pool);
+    f.close();
+
+    // Must not wait for pool threads if all of them are busy
+    int maxThreadCount = QtRAR::maxThreadCount();
+    QtRAR::setMaxThreadCount(4);
+    pool.setMaxThreadCount(1);
+    QSemaphore busy;
+    pool.start([&busy]() { busy.acquire(); });
+
+    QtRARFile rar5("assets/rar5.rar", "rar5.txt");
+    QVERIFY(rar5.open(QIODevice::ReadOnly));
+    QVERIFY(rar5.size() > 0);
+    rar5.close();
+
+    busy.release();
+    pool.waitForDone();
+    QtRAR::setMaxThreadCount(maxThreadCount);
+
+    QVERIFY(QtRAR::setThreadPool(0));
+    QCOMPARE(QtRAR::threadPool(), (QThreadPool *)0);
+}
+
+void TestQtRAR::memoryPool()
+{
+    qint64 limit = QtRAR::memoryPoolLimit();
+    QVERIFY(limit > 0);
+
+    // Extract the same file with cached and with released memory
+    for (int i = 0; i < 3; i++) {
+        QtRAR::setMemoryPoolLimit(i == 2 ? 0 : limit);
+        QCOMPARE(QtRAR::memoryPoolLimit(), i == 2 ? 0 : limit);
+        QtRAR::setHugePagesEnabled(i == 1);
+        QCOMPARE(QtRAR::hugePagesEnabled(), i == 1);
+
+        QtRARFile f("assets/multiple.rar", "qt.txt");
+        QVERIFY(f.open(QIODevice::ReadOnly));
+        QCOMPARE(f.readAll(), QByteArray("rar\n"));
+        f.close();
+
+        QtRARFile ppmd("assets/ppmd.rar", "ppmd.txt");
+        QVERIFY(ppmd.open(QIODevice::ReadOnly));
+        QCOMPARE(ppmd.readAll().size(), 184896);
+        ppmd.close();
+    }
+
+    QtRAR::setMemoryPoolLimit(limit);
+    QtRAR::setHugePagesEnabled(false);
+}
+
+static QByteArray largeContent()
+{
+    // 4 MB in 1 MB dictionary. Every fourth 64 KB chunk repeats data
+    // 768 KB back, so matches cross many compressed blocks.
+    QByteArray content;
+    quint32 seed = 12345;
+    for (int chunk = 0; chunk < 64; ++chunk) {
+        int start = content.size();
+        if (chunk >= 12 && chunk % 4 == 3) {
+            content += content.mid(start - 12 * 65536, 65536);
+            continue;
+        }
+        while (content.size() < start + 65536) {
+            seed = seed * 1103515245 + 12345;
+            content += "record " + QByteArray::number(content.size())
+                    + " value " + QByteArray::number(seed >> 24) + "\n";
+        }
+        content.truncate(start + 65536);
+    }
+    return content;
+}
+
+void TestQtRAR::benchmarkMaxThreadCount()
+{
+    QFETCH(int, threads);
+    QByteArray content = largeContent();
+
+    int maxThreadCount = QtRAR::maxThreadCount();
+    QtRAR::setMaxThreadCount(threads);
+
+    QBENCHMARK {
+        QtRARFile f("assets/large.rar", "large.txt");
+        QVERIFY(f.open(QIODevice::ReadOnly));
+        QCOMPARE(f.readAll().size(), content.size());
+    }
+
+    QtRAR::setMaxThreadCount(maxThreadCount);
+}
+
+void TestQtRAR::benchmarkMaxThreadCount_data()
+{
+    QTest::addColumn<int>("threads");
+
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        QTest::newRow(QByteArray::number(threads).constData()) << threads;
+    }
+}
+
+static QByteArray fileContent(const QString &fileName)
+{
+    QFile f(fileName);
+    return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+}
+
+void TestQtRAR::repairVolumes()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QStringList names = QDir("assets").entryList(QStringList() << "recovery.part*");
+    QCOMPARE(names.size(), 6);
+    foreach (const QString &name, names) {
+        QVERIFY(QFile::copy("assets/" + name, dir.path() + "/" + name));
+    }
+
+    // Remove one volume and damage another one
+    QVERIFY(QFile::remove(dir.path() + "/recovery.part2.rar"));
+    QFile damaged(dir.path() + "/recovery.part3.rar");
+    QVERIFY(damaged.open(QIODevice::ReadWrite));
+    QVERIFY(damaged.seek(100));
+    damaged.write("damaged");
+    damaged.close();
+
+    QtRAR rar(dir.path() + "/recovery.part1.rar");
+    QVERIFY(rar.repairVolumes());
+    QCOMPARE(rar.error(), 0);
+    QCOMPARE(fileContent(dir.path() + "/recovery.part2.rar"),
+             fileContent("assets/recovery.part2.rar"));
+    QCOMPARE(fileContent(dir.path() + "/recovery.part3.rar"),
+             fileContent("assets/recovery.part3.rar"));
+
+    QtRARFile f(dir.path() + "/recovery.part1.rar", "recovery.txt");
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QCOMPARE(f.readAll().size(), 74259);
+    f.close();
+
+    // Cannot restore more volumes than we have recovery volumes
+    QVERIFY(QFile::remove(dir.path() + "/recovery.part2.rar"));
+    QVERIFY(QFile::remove(dir.path() + "/recovery.part3.rar"));
+    QVERIFY(QFile::remove(dir.path() + "/recovery.part4.rar"));
+    QVERIFY(!rar.repairVolumes());
+    QVERIFY(rar.error() != 0);
+
+    // Archive must be closed
+    QtRAR opened("assets/multiple.rar");
+    QVERIFY(opened.open(QtRAR::OpenModeList));
+    QVERIFY(!opened.repairVolumes());
+}
+
+void TestQtRAR::repairLegacyVolumes()
+{
+    // RAR 3.x volumes with old style names and recovery volumes
+    // named <volumes>_<recovery volumes>_<number>.rev
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QStringList names = QDir("assets").entryList(QStringList() << "oldrev*");
+    QCOMPARE(names.size(), 9);
+    foreach (const QString &name, names) {
+        QVERIFY(QFile::copy("assets/" + name, dir.path() + "/" + name));
+    }
+
+    // Remove one volume and damage another one
+    QVERIFY(QFile::remove(dir.path() + "/oldrev.r01"));
+    QFile damaged(dir.path() + "/oldrev.r02");
+    QVERIFY(damaged.open(QIODevice::ReadWrite));
+    QVERIFY(damaged.seek(100));
+    damaged.write("damaged");
+    damaged.close();
+
+    QtRAR rar(dir.path() + "/oldrev.rar");
+    QVERIFY(rar.repairVolumes());
+    QCOMPARE(rar.error(), 0);
+    QCOMPARE(fileContent(dir.path() + "/oldrev.r01"),
+             fileContent("assets/oldrev.r01"));
+    QCOMPARE(fileContent(dir.path() + "/oldrev.r02"),
+             fileContent("assets/oldrev.r02"));
+    QVERIFY(QFile::exists(dir.path() + "/oldrev.r02.bad"));
+
+    QtRARFile f(dir.path() + "/oldrev.rar", "oldrev.txt");
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QCOMPARE(f.readAll().size(), 64666);
+    f.close();
+
+    // Cannot restore more volumes than we have recovery volumes
+    QVERIFY(QFile::remove(dir.path() + "/oldrev.r01"));
+    QVERIFY(QFile::remove(dir.path() + "/oldrev.r02"));
+    QVERIFY(QFile::remove(dir.path() + "/oldrev.r03"));
+    QVERIFY(!rar.repairVolumes());
+    QVERIFY(rar.error() != 0);
+}
+
+void TestQtRAR::verify()
+{
+    QStringList damagedFiles;
+    QtRAR rar("assets/volumes.part1.rar");
+    QVERIFY(rar.verify(QString(), &damagedFiles));
+    QCOMPARE(rar.error(), 0);
+    QVERIFY(damagedFiles.isEmpty());
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QStringList names = QDir("assets").entryList(QStringList() << "volumes.part*");
+    QCOMPARE(names.size(), 12);
+    foreach (const QString &name, names) {
+        QVERIFY(QFile::copy("assets/" + name, dir.path() + "/" + name));
+    }
+
+    // Damage a volume in the middle of the set
+    QFile damaged(dir.path() + "/volumes.part5.rar");
+    QVERIFY(damaged.open(QIODevice::ReadWrite));
+    QVERIFY(damaged.seek(3000));
+    damaged.write("damaged");
+    damaged.close();
+
+    QtRAR damagedRar(dir.path() + "/volumes.part1.rar");
+    QVERIFY(!damagedRar.verify(QString(), &damagedFiles));
+    QVERIFY(damagedRar.error() != 0);
+    QCOMPARE(damagedFiles, QStringList() << "file06.txt");
+
+    // Single volume archive with encrypted headers
+    QtRAR encrypted("assets/password-header.rar");
+    QVERIFY(encrypted.verify("qt"));
+    QVERIFY(!encrypted.verify());
+
+    // Archive must be closed
+    QtRAR opened("assets/multiple.rar");
+    QVERIFY(opened.open(QtRAR::OpenModeList));
+    QVERIFY(!opened.verify());
+}
+
 QTEST_MAIN(TestQtRAR)
 #include "qtrar_test.moc"
@@ -1,3 +1,4 @@
+#include <QCryptographicHash>
 #include <QImage>
 #include <QImageReader>
 #include <QTest>
@@ -23,6 +24,18 @@ private slots:
     void password_data();
     void imageInArchive();
     void imageInArchive_data();
+    void ppmd();
+    void benchmarkPpmd();
+    void legacy();
+    void legacy_data();
+    void benchmarkLegacy();
+    void benchmarkLegacy_data();
+    void rar5();
+    void benchmarkRar5();
+    void executable();
+    void benchmarkExecutable();
+    void multithread();
+    void multithread_data();
 
 private:
     QtRAR *m_rar;
@@ -371,5 +384,219 @@ void TestQtRARFile::imageInArchive_data()
         << QSize(5, 5);
 }
 
+static QByteArray ppmdContent()
+{
+    QByteArray content;
+    for (int i = 0; i < 4096; ++i) {
+        content += QByteArray::number(i) + " quick brown foxes jump over "
+                + QByteArray::number(i % 17) + " lazy dogs\n";
+    }
+    return content;
+}
+
+void TestQtRARFile::ppmd()
+{
+    QtRARFile f("assets/ppmd.rar", "ppmd.txt");
+    QVERIFY2(f.open(QtRARFile::ReadOnly), "fail to open archive");
+    QCOMPARE(f.readAll(), ppmdContent());
+}
+
+void TestQtRARFile::benchmarkPpmd()
+{
+    QByteArray content = ppmdContent();
+
+    QBENCHMARK {
+        QtRARFile f("assets/ppmd.rar", "ppmd.txt");
+        QVERIFY(f.open(QtRARFile::ReadOnly));
+        QCOMPARE(f.readAll().size(), content.size());
+    }
+}
+
+static QByteArray legacyContent()
+{
+    QByteArray content;
+    for (int i = 0; i < 2048; ++i) {
+        content += QByteArray::number(i) + " old archivers packed "
+                + QByteArray::number(i % 13) + " files per floppy\n";
+    }
+    return content;
+}
+
+void TestQtRARFile::legacy()
+{
+    QFETCH(QString, arcName);
+
+    QtRARFile f(arcName, "legacy.txt");
+    QVERIFY2(f.open(QtRARFile::ReadOnly), "fail to open archive");
+    QCOMPARE(f.readAll(), legacyContent());
+}
+
+void TestQtRARFile::legacy_data()
+{
+    QTest::addColumn<QString>("arcName");
+
+    QTest::newRow("RAR 1.5") << "assets/legacy15.rar";
+    QTest::newRow("RAR 2.0") << "assets/legacy20.rar";
+}
+
+void TestQtRARFile::benchmarkLegacy()
+{
+    QFETCH(QString, arcName);
+    QByteArray content = legacyContent();
+
+    QBENCHMARK {
+        QtRARFile f(arcName, "legacy.txt");
+        QVERIFY(f.open(QtRARFile::ReadOnly));
+        QCOMPARE(f.readAll().size(), content.size());
+    }
+}
+
+void TestQtRARFile::benchmarkLegacy_data()
+{
+    legacy_data();
+}
+
+static QByteArray rar5Content()
+{
+    QByteArray content;
+    for (int i = 0; i < 8192; ++i) {
+        content += "block " + QByteArray::number(i * 7919 % 65536)
+                + " of dictionary " + QByteArray::number(i % 29)
+                + " holds " + QByteArray::number(i % 5 * 1000) + " matches\n";
+    }
+    return content;
+}
+
+void TestQtRARFile::rar5()
+{
+    QtRARFile f("assets/rar5.rar", "rar5.txt");
+    QVERIFY2(f.open(QtRARFile::ReadOnly), "fail to open archive");
+    QCOMPARE(f.readAll(), rar5Content());
+}
+
+void TestQtRARFile::benchmarkRar5()
+{
+    QByteArray content = rar5Content();
+
+    QBENCHMARK {
+        QtRARFile f("assets/rar5.rar", "rar5.txt");
+        QVERIFY(f.open(QtRARFile::ReadOnly));
+        QCOMPARE(f.readAll().size(), content.size());
+    }
+}
+
+void TestQtRARFile::executable()
+{
+    // Stripped x86-64 build of unrar, entirely covered by alternating
+    // E8, E8E9 and ARM filters. Extraction fails on CRC mismatch.
+    QtRARFile f("assets/executable.rar", "unrar-x64.elf");
+    QVERIFY2(f.open(QtRARFile::ReadOnly), "fail to open archive");
+
+    QByteArray content = f.readAll();
+    QCOMPARE(content.size(), 355544);
+    QVERIFY(content.startsWith("\x7f" "ELF"));
+    QCOMPARE(QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex(),
+             QByteArray("7912a37bf672c29b12e6d85a7c7c4d37c7ea1d85"));
+}
+
+void TestQtRARFile::benchmarkExecutable()
+{
+    QBENCHMARK {
+        QtRARFile f("assets/executable.rar", "unrar-x64.elf");
+        QVERIFY(f.open(QtRARFile::ReadOnly));
+        QCOMPARE(f.readAll().size(), 355544);
+    }
+}
+
+static QByteArray multithreadContent()
+{
+    // 2 MB in 1 MB dictionary. Random lines are decoded in parallel and
+    // short copies 6000 bytes back refer to preceding blocks. Chunks of
+    // E8 calls and copies 768 KB back follow them.
+    QByteArray content;
+    quint32 seed = 1;
+    for (int chunk = 0; chunk < 32; ++chunk) {
+        int start = content.size();
+        if (chunk >= 12 && (chunk % 8 == 5 || chunk % 8 == 7)) {
+            content += content.mid(start - 12 * 65536, 65536);
+        } else if (chunk % 8 == 2) {
+            for (int i = 0; i < 65536 / 8; ++i) {
+                quint32 addr = quint32(i * 97 % 8192) - 4096;
+                content += '\xe8';
+                for (int k = 0; k < 4; ++k) {
+                    content += char(addr >> (8 * k));
+                }
+                content += "\x90\x90\x90";
+            }
+        } else {
+            while (content.size() < start + 65536) {
+                if (content.size() % 4096 < 61 && content.size() >= 6000) {
+                    content += content.mid(content.size() - 6000, 48);
+                }
+                for (int i = 0; i < 60; ++i) {
+                    seed = seed * 1103515245 + 12345;
+                    content += "acgt"[seed >> 30];
+                }
+                content += '\n';
+            }
+            content.truncate(start + 65536);
+        }
+    }
+    return content;
+}
+
+static QByteArray singleThreadContent()
+{
+    // Most matches refer to preceding blocks, so decoder switches
+    // to single threaded processing.
+    QByteArray content;
+    quint32 seed = 2;
+    while (content.size() < 24576) {
+        seed = seed * 1103515245 + 12345;
+        content += "record " + QByteArray::number(content.size())
+                + " value " + QByteArray::number(seed >> 24) + "\n";
+    }
+    content.truncate(24576);
+    while (content.size() < 512 * 1024) {
+        content += content.at(content.size() - 24576);
+    }
+    return content;
+}
+
+void TestQtRARFile::multithread()
+{
+    QFETCH(QString, fileName);
+    QFETCH(int, threads);
+    QFETCH(QByteArray, content);
+
+    // Unpack thread count follows the pool size even on a single core
+    int maxThreadCount = QtRAR::maxThreadCount();
+    QtRAR::setMaxThreadCount(threads);
+
+    QtRARFile f("assets/multithread.rar", fileName);
+    bool isOpen = f.open(QtRARFile::ReadOnly);
+    QByteArray data = f.readAll();
+
+    QtRAR::setMaxThreadCount(maxThreadCount);
+    QVERIFY2(isOpen, "fail to open archive");
+    QCOMPARE(data, content);
+}
+
+void TestQtRARFile::multithread_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<QByteArray>("content");
+
+    QByteArray content = multithreadContent();
+    QByteArray singleContent = singleThreadContent();
+    for (int threads = 1; threads <= 64; threads *= 4) {
+        QTest::newRow(("filters, " + QByteArray::number(threads)).constData())
+            << "mt.txt" << threads << content;
+        QTest::newRow(("single, " + QByteArray::number(threads)).constData())
+            << "single.txt" << threads << singleContent;
+    }
+}
+
 QTEST_MAIN(TestQtRARFile)
 #include "qtrarfile_test.moc"
\ No newline at end of file
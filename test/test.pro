@@ -14,7 +14,7 @@ win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/src/release/ -lQtRAR
 else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/src/debug/ -lQtRAR
 else:unix: LIBS += -L$$OUT_PWD/src -lQtRAR
 
-assets.files = $$PWD/assets/*.rar
+assets.files = $$PWD/assets/*.rar $$PWD/assets/*.r0* $$PWD/assets/*.rev
 assets.path = $$OUT_PWD
 
 INSTALLS += assets
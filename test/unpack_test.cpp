@@ -0,0 +1,183 @@
+#include <QRandomGenerator>
+#include <QTest>
+
+#include "../src/unrar/rar.hpp"
+
+#include "../src/qtrar.h"
+#include "../src/qtrarfile.h"
+
+class TestUnpack : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+
+    void deltaFilter();
+    void deltaFilter_data();
+    void windowType();
+    void windowType_data();
+    void benchmarkDecoder();
+    void benchmarkDecoder_data();
+
+private:
+    int m_maxThreadCount;
+};
+
+// Plain per channel loop used by unrar before the filter was vectorized.
+static void referenceDeltaFilter(byte *dst, const byte *src, uint dataSize, uint channels)
+{
+    for (uint channel = 0, srcPos = 0; channel < channels; channel++) {
+        byte prevByte = 0;
+        for (uint destPos = channel; destPos < dataSize; destPos += channels)
+            dst[destPos] = (prevByte -= src[srcPos++]);
+    }
+}
+
+void TestUnpack::initTestCase()
+{
+    // Window type specific decoders are used in single threaded mode only
+    m_maxThreadCount = QtRAR::maxThreadCount();
+    QtRAR::setMaxThreadCount(1);
+}
+
+void TestUnpack::cleanupTestCase()
+{
+    QtRAR::setMaxThreadCount(m_maxThreadCount);
+}
+
+void TestUnpack::cleanup()
+{
+    ResetUnpackWindowType();
+}
+
+void TestUnpack::deltaFilter()
+{
+    QFETCH(bool, vectorized);
+
+#ifdef USE_SSE
+    if (vectorized && _SSE_Version < SSE_SSSE3)
+        QSKIP("CPU does not support SSSE3");
+#endif
+
+    // Vector code handles 16 bytes per channel, so include sizes leaving
+    // tails of every length and channel lengths below a single vector.
+    const uint sizes[] = {0, 1, 15, 16, 17, 31, 33, 64, 100, 255, 1000, 4097, 65536 + 77};
+    const uint guard = 64;
+
+    QRandomGenerator random(0x44454c54);
+    for (uint channels = 1; channels <= 32; channels++) {
+        for (uint size : sizes) {
+            QByteArray src(size, 0);
+            for (int i = 0; i < src.size(); i++)
+                src[i] = char(random.bounded(256));
+
+            QByteArray expected(size + guard, char(0x5a));
+            referenceDeltaFilter((byte *)expected.data(), (const byte *)src.constData(), size, channels);
+
+            QByteArray dst(size + guard, char(0x5a));
+            UnpackDeltaFilter((byte *)dst.data(), (const byte *)src.constData(), size, channels, vectorized);
+
+            QVERIFY2(dst == expected, qPrintable(QString("channels %1, size %2").arg(channels).arg(size)));
+        }
+    }
+}
+
+void TestUnpack::deltaFilter_data()
+{
+    QTest::addColumn<bool>("vectorized");
+
+    QTest::newRow("scalar") << false;
+#ifdef USE_SSE
+    QTest::newRow("ssse3") << true;
+#elif defined(USE_NEON)
+    QTest::newRow("neon") << true;
+#endif
+}
+
+static QByteArray windowContent()
+{
+    // 6 MB of text in 16 MB dictionary. Copies of data from up to 3 MB
+    // back cross 4 MB blocks of fragmented window.
+    QByteArray content;
+    for (int i = 0; i < 8192; ++i) {
+        content += "entry " + QByteArray::number(i * 7919 % 65536)
+                + " in window " + QByteArray::number(i % 31) + "\n";
+    }
+    for (int i = 0; content.size() < 6 * 1024 * 1024; ++i) {
+        int distance = content.size() / 2 + i * 4099 % 65536;
+        content += content.mid(content.size() - distance, 40000)
+                + "copy " + QByteArray::number(i) + "\n";
+    }
+    return content;
+}
+
+void TestUnpack::windowType()
+{
+    QFETCH(int, windowType);
+
+#ifndef USE_MIRROR_WINDOW
+    if (windowType == UNPWIN_MIRRORED)
+        QSKIP("Mirrored window is not supported on this platform");
+#endif
+    SetUnpackWindowType((UNPACK_WINDOW_TYPE)windowType);
+
+    // Solid archive, so the window is not reduced to file size
+    QtRARFile f("assets/window.rar", "window.txt");
+    QVERIFY2(f.open(QtRARFile::ReadOnly), "fail to open archive");
+    QCOMPARE(f.readAll(), windowContent());
+}
+
+void TestUnpack::windowType_data()
+{
+    QTest::addColumn<int>("windowType");
+
+    QTest::newRow("normal") << int(UNPWIN_NORMAL);
+    QTest::newRow("mirrored") << int(UNPWIN_MIRRORED);
+    QTest::newRow("fragmented") << int(UNPWIN_FRAGMENTED);
+    QTest::newRow("generic") << int(UNPWIN_GENERIC);
+}
+
+void TestUnpack::benchmarkDecoder()
+{
+    QFETCH(QString, arcName);
+    QFETCH(QString, fileName);
+    QFETCH(bool, generic);
+
+    if (generic)
+        SetUnpackWindowType(UNPWIN_GENERIC);
+
+    QBENCHMARK {
+        QtRARFile f(arcName, fileName);
+        QVERIFY(f.open(QtRARFile::ReadOnly));
+        QVERIFY(!f.readAll().isEmpty());
+    }
+}
+
+void TestUnpack::benchmarkDecoder_data()
+{
+    QTest::addColumn<QString>("arcName");
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<bool>("generic");
+
+    // Compare decoders specialized for window type with generic one
+    const char *archives[][2] = {
+        {"rar5.rar", "rar5.txt"},
+        {"large.rar", "large.txt"},
+        {"executable.rar", "unrar-x64.elf"},
+        {"window.rar", "window.txt"}
+    };
+    for (auto archive : archives) {
+        for (bool generic : {false, true}) {
+            QByteArray name = QByteArray(archive[0]) + (generic ? " generic" : " specialized");
+            QTest::newRow(name.constData())
+                << QString("assets/") + archive[0]
+                << QString(archive[1])
+                << generic;
+        }
+    }
+}
+
+QTEST_MAIN(TestUnpack)
+#include "unpack_test.moc"